@@ -0,0 +1,171 @@
+#include "ConnectionScan.h"
+#include <vector>
+#include <algorithm>
+
+namespace {
+
+const uint32_t NO_LABEL = UINT32_MAX;
+
+// Labels are appended to a pool and never changed, so a label's parent chain stays valid
+// however often the stops it passed through improve later in the scan
+struct CsaLabel {
+    Journey journey;
+    uint32_t stop;   // where the label arrives
+    uint32_t trips;  // at most Journey::MAX_TRIP_COUNT: labels that far in board nothing
+    uint32_t parent; // pool index of the label this one continues, NO_LABEL for the start
+};
+
+// Per-query state, kept per thread and reused. Per-stop and per-trip entries carry the epoch
+// of the query that wrote them, so starting a query never clears anything.
+struct CsaWorkspace {
+    std::vector<CsaLabel> pool;
+    std::vector<uint32_t> best;         // per stop: earliest label of any kind
+    std::vector<uint32_t> by_trip;      // per stop: earliest label arriving by trip
+    std::vector<uint32_t> stop_stamps;
+    std::vector<uint32_t> trip_board;   // per trip slot: label boarded from
+    std::vector<uint32_t> trip_stamps;
+    std::vector<int32_t> walk_to_end;   // per stop: walk to the destination, if stamped
+    std::vector<uint32_t> walk_stamps;
+    uint32_t epoch = 0;
+
+    void startQuery(size_t num_stops, size_t num_trips) {
+        if (best.size() != num_stops || trip_board.size() != num_trips) {
+            best.assign(num_stops, NO_LABEL);
+            by_trip.assign(num_stops, NO_LABEL);
+            stop_stamps.assign(num_stops, 0);
+            walk_to_end.assign(num_stops, 0);
+            walk_stamps.assign(num_stops, 0);
+            trip_board.assign(num_trips, NO_LABEL);
+            trip_stamps.assign(num_trips, 0);
+            epoch = 0;
+        }
+        if (++epoch == 0) { // wrapped around: stale stamps could look current again
+            std::fill(stop_stamps.begin(), stop_stamps.end(), 0);
+            std::fill(walk_stamps.begin(), walk_stamps.end(), 0);
+            std::fill(trip_stamps.begin(), trip_stamps.end(), 0);
+            epoch = 1;
+        }
+        pool.clear();
+    }
+
+    // Earliest label of a stop of either kind, or NO_LABEL
+    uint32_t bestAt(uint32_t stop) const { return stop_stamps[stop] == epoch ? best[stop] : NO_LABEL; }
+    uint32_t tripAt(uint32_t stop) const { return stop_stamps[stop] == epoch ? by_trip[stop] : NO_LABEL; }
+    bool beats(uint32_t label, const Time& arrival) const { return label == NO_LABEL || arrival < pool[label].journey.arrival_time; }
+
+    uint32_t add(uint32_t stop, Time arrival, LegKind kind, int32_t from_stop, uint32_t trip, uint32_t parent) {
+        uint32_t trips = parent == NO_LABEL ? 0 : pool[parent].trips + (kind == LegKind::Trip ? 1 : 0);
+        pool.push_back({Journey(arrival, Time(), 0, from_stop, kind, trip), stop, trips, parent});
+        return static_cast<uint32_t>(pool.size() - 1);
+    }
+    void setBest(uint32_t stop, uint32_t label) {
+        if (stop_stamps[stop] != epoch) {
+            stop_stamps[stop] = epoch;
+            by_trip[stop] = NO_LABEL;
+        }
+        best[stop] = label;
+    }
+    void setTrip(uint32_t stop, uint32_t label) {
+        if (stop_stamps[stop] != epoch) {
+            stop_stamps[stop] = epoch;
+            best[stop] = NO_LABEL;
+        }
+        by_trip[stop] = label;
+    }
+};
+
+CsaWorkspace& threadWorkspace() {
+    thread_local CsaWorkspace ws;
+    return ws;
+}
+
+} // namespace
+
+bool runConnectionScan(uint32_t start_stop_idx, uint32_t end_stop_idx, const Time& start_time,
+                       const StopTable& stops,
+                       const FootpathGraph& footpaths,
+                       const Timetable& timetable,
+                       const ConnectionTable& connections,
+                       Journey& journey,
+                       JourneyLegs& predecessors,
+                       const LandmarkTable* landmarks) {
+    CsaWorkspace& ws = threadWorkspace();
+    ws.startQuery(stops.size(), timetable.pattern_trips.size());
+
+    // Stops the destination can be reached from on foot; `target` is the best arrival so far
+    for (const Footpath* walk = footpaths.inBegin(end_stop_idx); walk != footpaths.inEnd(end_stop_idx); ++walk) {
+        ws.walk_to_end[walk->stop] = walk->duration_seconds;
+        ws.walk_stamps[walk->stop] = ws.epoch;
+    }
+    uint32_t target = NO_LABEL;
+    auto reachedStop = [&](uint32_t stop, uint32_t label) {
+        ws.setBest(stop, label);
+        const Time arrival = ws.pool[label].journey.arrival_time;
+        if (stop == end_stop_idx) {
+            if (ws.beats(target, arrival)) target = label;
+        } else if (ws.walk_stamps[stop] == ws.epoch && ws.beats(target, arrival + ws.walk_to_end[stop])) {
+            target = ws.add(end_stop_idx, arrival + ws.walk_to_end[stop], LegKind::Walk, static_cast<int32_t>(stop), 0, label);
+        }
+    };
+
+    // Whether nothing continuing from `stop` can beat the destination label any more
+    if (landmarks && landmarks->count() == 0) landmarks = nullptr;
+    auto hopeless = [&](uint32_t stop, const Time& arrival) {
+        return landmarks && target != NO_LABEL &&
+               arrival + landmarks->lowerBound(stop, end_stop_idx) >= ws.pool[target].journey.arrival_time;
+    };
+
+    const int32_t start = static_cast<int32_t>(start_stop_idx);
+    const uint32_t start_label = ws.add(start_stop_idx, start_time, LegKind::Start, -1, 0, NO_LABEL);
+    reachedStop(start_stop_idx, start_label);
+    for (const Footpath* walk = footpaths.outBegin(start_stop_idx); walk != footpaths.outEnd(start_stop_idx); ++walk) {
+        Time arrival = start_time + walk->duration_seconds;
+        if (ws.beats(ws.bestAt(walk->stop), arrival)) {
+            reachedStop(walk->stop, ws.add(walk->stop, arrival, LegKind::Walk, start, 0, start_label));
+        }
+    }
+
+    const Connection* conn = connections.connections.data();
+    for (uint32_t c = connections.firstDeparting(start_time.toSeconds()); c < connections.size(); ++c) {
+        // Everything from here on leaves too late to arrive any earlier
+        if (target != NO_LABEL && conn[c].departure >= ws.pool[target].journey.arrival_time.toSeconds()) break;
+
+        // Stay on a trip once boarded; otherwise board if we are at the stop in time
+        const uint32_t trip = conn[c].trip;
+        if (ws.trip_stamps[trip] != ws.epoch) {
+            uint32_t at_stop = ws.bestAt(conn[c].from_stop);
+            if (at_stop == NO_LABEL || ws.pool[at_stop].journey.arrival_time.toSeconds() > conn[c].departure) continue;
+            if (ws.pool[at_stop].trips == Journey::MAX_TRIP_COUNT) continue; // no trip count left to record it
+
+            ws.trip_stamps[trip] = ws.epoch;
+            ws.trip_board[trip] = at_stop;
+        }
+
+        const uint32_t to_stop = conn[c].to_stop;
+        const Time arrival(conn[c].arrival);
+        if (!ws.beats(ws.tripAt(to_stop), arrival) || hopeless(to_stop, arrival)) continue;
+        const uint32_t boarded = ws.trip_board[trip];
+        const uint32_t label = ws.add(to_stop, arrival, LegKind::Trip, static_cast<int32_t>(ws.pool[boarded].stop), trip, boarded);
+        ws.setTrip(to_stop, label);
+        if (ws.beats(ws.bestAt(to_stop), arrival)) reachedStop(to_stop, label);
+
+        // Walk on from the trip; the footpath graph is closed, so one walk is enough
+        for (const Footpath* walk = footpaths.outBegin(to_stop); walk != footpaths.outEnd(to_stop); ++walk) {
+            Time walk_arrival = arrival + walk->duration_seconds;
+            if (ws.beats(ws.bestAt(walk->stop), walk_arrival) && !hopeless(walk->stop, walk_arrival)) {
+                reachedStop(walk->stop, ws.add(walk->stop, walk_arrival, LegKind::Walk, static_cast<int32_t>(to_stop), 0, label));
+            }
+        }
+    }
+    if (target == NO_LABEL) return false;
+
+    // Unwind the parent chain into the per-(stop, trips) labels reconstructPath follows
+    for (uint32_t l = target; l != NO_LABEL; l = ws.pool[l].parent) {
+        const CsaLabel& leg = ws.pool[l];
+        Journey labelled(leg.journey.arrival_time, start_time, static_cast<int>(leg.trips),
+                         leg.journey.from_stop_idx, leg.journey.kind(), leg.journey.trip());
+        if (l == target) journey = labelled;
+        else predecessors.set(leg.stop, labelled);
+    }
+    return true;
+}
@@ -0,0 +1,28 @@
+#ifndef CONNECTIONSCAN_H_INCLUDED
+#define CONNECTIONSCAN_H_INCLUDED
+
+#include <cstdint>
+#include "DataTypes.h"
+#include "Network.h"
+
+// Connection Scan Algorithm: the earliest arrival at end_stop_idx leaving start_stop_idx at
+// start_time, with up to Journey::MAX_TRIP_COUNT trips. Scans the departure-sorted
+// connections once from the first one leaving at start_time and stops as soon as no later
+// connection can arrive earlier. Walks follow the same rules as RAPTOR: from the origin,
+// after a trip, and to the destination. Returns false when the destination is not reached
+// that day.
+//
+// `journey` and `predecessors` come in the shape reconstructPath expects. A stop first
+// reached with the full trip count boards nothing further, so every label fits Journey.
+// With `landmarks` (see Landmarks.h), once the destination is reached, labels that cannot
+// beat it even at the landmark lower bound are dropped; the arrival found is the same.
+bool runConnectionScan(uint32_t start_stop_idx, uint32_t end_stop_idx, const Time& start_time,
+                       const StopTable& stops,
+                       const FootpathGraph& footpaths,
+                       const Timetable& timetable,
+                       const ConnectionTable& connections,
+                       Journey& journey,
+                       JourneyLegs& predecessors,
+                       const LandmarkTable* landmarks = nullptr);
+
+#endif // CONNECTIONSCAN_H_INCLUDED
@@ -0,0 +1,30 @@
+#include "Connections.h"
+#include <vector>
+#include <algorithm>
+
+uint32_t ConnectionTable::firstDeparting(int32_t time) const {
+    auto it = std::lower_bound(connections.begin(), connections.end(), time,
+        [](const Connection& c, int32_t t) { return c.departure < t; });
+    return static_cast<uint32_t>(it - connections.begin());
+}
+
+ConnectionTable buildConnections(const Timetable& timetable) {
+    std::vector<Connection> connections;
+    connections.reserve(timetable.arrivals.size());
+    for (uint32_t p = 0; p < timetable.patterns.size(); ++p) {
+        const RoutePattern& route = timetable.patterns[p];
+        for (uint32_t t = 0; t < route.num_trips; ++t) {
+            for (uint32_t i = 0; i + 1 < route.num_stops; ++i) {
+                connections.push_back({timetable.stop(p, i), timetable.stop(p, i + 1),
+                                       timetable.departure(p, t, i), timetable.arrival(p, t, i + 1), route.first_trip + t});
+            }
+        }
+    }
+    // A zero-length hop departs when the previous one arrives; the stable sort keeps it after it
+    std::stable_sort(connections.begin(), connections.end(),
+        [](const Connection& a, const Connection& b) { return a.departure < b.departure; });
+
+    ConnectionTable table;
+    table.connections = std::move(connections);
+    return table;
+}
@@ -0,0 +1,33 @@
+#ifndef CONNECTIONS_H_INCLUDED
+#define CONNECTIONS_H_INCLUDED
+
+#include <cstdint>
+#include "DataTypes.h"
+#include "FlatArray.h"
+#include "Timetable.h"
+
+// One hop of a trip between two consecutive stops. `trip` is the timetable trip slot (an
+// index into Timetable::pattern_trips).
+struct Connection {
+    uint32_t from_stop;
+    uint32_t to_stop;
+    int32_t departure;
+    int32_t arrival;
+    uint32_t trip;
+};
+
+// Every connection of the timetable in one contiguous array sorted by departure, the input
+// of the Connection Scan Algorithm (ConnectionScan.h). Ties keep the order of the hops
+// within a trip, so a trip's connections are scanned in sequence.
+struct ConnectionTable {
+    FlatArray<Connection> connections;
+
+    size_t size() const { return connections.size(); }
+
+    // Index of the first connection departing at or after `time`
+    uint32_t firstDeparting(int32_t time) const;
+};
+
+ConnectionTable buildConnections(const Timetable& timetable);
+
+#endif // CONNECTIONS_H_INCLUDED
@@ -5,45 +5,123 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <charconv>
 #include <cstdio>
+#include <cstdint>
 #include <cmath> // --- NEW --- For math functions
 
 // --- Core Data Structures ---
 
+// A point in time as seconds since the start of the service day. GTFS allows hours past 24
+// for trips running after midnight, so values are not wrapped. Formatting back to HH:MM:SS
+// only happens when writing responses (operator<<).
 struct Time {
-    int h = 0, m = 0, s = 0;
-    Time() = default;
-    Time(const std::string& t_str) { sscanf(t_str.c_str(), "%d:%d:%d", &h, &m, &s); }
-    int toSeconds() const { return h * 3600 + m * 60 + s; }
-    static Time fromSeconds(int total_seconds) {
-        Time t;
-        t.h = total_seconds / 3600;
-        t.m = (total_seconds % 3600) / 60;
-        t.s = total_seconds % 60;
-        return t;
+    int32_t seconds = 0;
+    constexpr Time() = default;
+    constexpr explicit Time(int32_t total_seconds) : seconds(total_seconds) {}
+
+    // Parses "H:MM:SS" (hours may go past 24); leaves `out` untouched and returns false
+    // when the text is malformed: a sign, minutes or seconds outside 0-59, or anything but
+    // blanks around the time.
+    static bool parse(std::string_view text, Time& out) {
+        const char* p = text.data();
+        const char* end = p + text.size();
+        while (p != end && *p == ' ') ++p;
+        int parts[3];
+        for (int i = 0; i < 3; ++i) {
+            if (p == end || *p < '0' || *p > '9') return false; // from_chars would take a '-'
+            auto result = std::from_chars(p, end, parts[i]);
+            if (result.ec != std::errc()) return false;
+            p = result.ptr;
+            if (i < 2) {
+                if (p == end || *p != ':') return false;
+                ++p;
+            }
+        }
+        while (p != end && *p == ' ') ++p;
+        if (p != end || parts[0] > (INT32_MAX - 3599) / 3600 || parts[1] > 59 || parts[2] > 59) return false;
+        out = Time(parts[0] * 3600 + parts[1] * 60 + parts[2]);
+        return true;
     }
-    bool operator>(const Time& other) const { return toSeconds() > other.toSeconds(); }
-    bool operator<(const Time& other) const { return toSeconds() < other.toSeconds(); }
-    bool operator>=(const Time& other) const { return toSeconds() >= other.toSeconds(); }
-    bool operator<=(const Time& other) const { return toSeconds() <= other.toSeconds(); }
+    constexpr int32_t toSeconds() const { return seconds; }
+    static constexpr Time fromSeconds(int32_t total_seconds) { return Time(total_seconds); }
+
+    constexpr Time operator+(int32_t delta_seconds) const { return Time(seconds + delta_seconds); }
+    constexpr int32_t operator-(const Time& other) const { return seconds - other.seconds; }
+    constexpr bool operator==(const Time& other) const { return seconds == other.seconds; }
+    constexpr bool operator!=(const Time& other) const { return seconds != other.seconds; }
+    constexpr bool operator>(const Time& other) const { return seconds > other.seconds; }
+    constexpr bool operator<(const Time& other) const { return seconds < other.seconds; }
+    constexpr bool operator>=(const Time& other) const { return seconds >= other.seconds; }
+    constexpr bool operator<=(const Time& other) const { return seconds <= other.seconds; }
 };
 
 struct Stop {
-    int id;
+    int id; // GTFS stop_id, only used for output
     std::string name;
     double lat = 0.0;
     double lon = 0.0;
 };
 
-struct StopTime { std::string trip_id; Time arrival_time; Time departure_time; int stop_id; int stop_sequence; };
-struct Transfer { int from_stop_id; int to_stop_id; int duration_seconds; };
+// Stops and trips are referred to by their dense index (see IdInterner.h), never by GTFS id
+struct StopTime { uint32_t trip_idx; Time arrival_time; Time departure_time; uint32_t stop_idx; int stop_sequence; };
+struct Transfer { uint32_t from_stop_idx; uint32_t to_stop_idx; int duration_seconds; };
+
+// How a label reached its stop
+enum class LegKind : uint32_t { Start = 0, Walk = 1, Trip = 2 };
 
+// A RAPTOR label. It is a 16-byte POD so label arrays stay dense and copying one is a few
+// register moves; the human-readable leg description is only built in reconstructPath.
+// For Trip legs from_stop_idx is the boarding stop and trip() is the timetable trip slot
+// (an index into Timetable::pattern_trips). For Walk legs it is the stop walked from.
 struct Journey {
     Time arrival_time;
-    int trips;
     Time departure_time;
-    int from_stop_id = -1;
-    std::string method;
+    int32_t from_stop_idx = -1;
+    uint32_t leg = 0; // kind in bits 30-31, trips in bits 26-29, trip slot in bits 0-25
+
+    static constexpr uint32_t TRIP_BITS = 26;
+    static constexpr uint32_t MAX_TRIP_SLOT = (1u << TRIP_BITS) - 1;
+    static constexpr uint32_t MAX_TRIP_COUNT = 15; // trips() has four bits
+
+    constexpr Journey() = default;
+    constexpr Journey(Time arrival, Time departure, int num_trips, int32_t from_stop, LegKind leg_kind, uint32_t trip_slot = 0)
+        : arrival_time(arrival), departure_time(departure), from_stop_idx(from_stop),
+          leg((static_cast<uint32_t>(leg_kind) << 30) | (static_cast<uint32_t>(num_trips) << TRIP_BITS) | trip_slot) {}
+
+    constexpr LegKind kind() const { return static_cast<LegKind>(leg >> 30); }
+    constexpr int trips() const { return static_cast<int>((leg >> TRIP_BITS) & 0xF); }
+    constexpr uint32_t trip() const { return leg & MAX_TRIP_SLOT; }
+};
+static_assert(sizeof(Journey) == 16, "Journey labels are meant to stay 16 bytes");
+
+// The labels one journey was built from, keyed by (stop, trips) the way the router labels
+// stops; reconstructPath follows them back from the destination. Storage is inline, so
+// result lists can be reused across queries without allocating.
+struct JourneyLegs {
+    static constexpr int CAPACITY = 2 * Journey::MAX_TRIP_COUNT + 3; // a walk before and after each trip
+
+    Journey labels[CAPACITY];
+    uint32_t stops[CAPACITY];
+    int count = 0;
+
+    void clear() { count = 0; }
+    const Journey* find(uint32_t stop, int trips) const {
+        for (int i = 0; i < count; ++i) {
+            if (stops[i] == stop && labels[i].trips() == trips) return &labels[i];
+        }
+        return nullptr;
+    }
+    // Stores the label of `stop` for label.trips(), replacing an earlier one
+    void set(uint32_t stop, const Journey& label) {
+        for (int i = 0; i < count; ++i) {
+            if (stops[i] == stop && labels[i].trips() == label.trips()) { labels[i] = label; return; }
+        }
+        if (count == CAPACITY) return;
+        stops[count] = stop;
+        labels[count++] = label;
+    }
 };
 
 // --- Helper Functions ---
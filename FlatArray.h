@@ -0,0 +1,64 @@
+#ifndef FLATARRAY_H_INCLUDED
+#define FLATARRAY_H_INCLUDED
+
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+// Read-only array that either owns its elements (when built from GTFS at startup) or views
+// memory it does not own (a mapped timetable snapshot). Routing code only reads, so both
+// cases look the same to it and a snapshot can be used in place without copying.
+template <typename T>
+class FlatArray {
+public:
+    FlatArray() = default;
+    FlatArray(std::vector<T>&& values) : owned_(std::move(values)) { sync(); }
+    FlatArray(const FlatArray& other) : owned_(other.owned_), data_(other.data_), size_(other.size_), is_view_(other.is_view_) { sync(); }
+    FlatArray(FlatArray&& other) noexcept
+        : owned_(std::move(other.owned_)), data_(other.data_), size_(other.size_), is_view_(other.is_view_) {
+        sync();
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.is_view_ = false;
+    }
+    FlatArray& operator=(FlatArray other) noexcept {
+        owned_.swap(other.owned_);
+        data_ = other.data_;
+        size_ = other.size_;
+        is_view_ = other.is_view_;
+        sync();
+        return *this;
+    }
+
+    // Views `size` elements at `data`; the memory must outlive the array
+    static FlatArray view(const T* data, size_t size) {
+        FlatArray array;
+        array.data_ = data;
+        array.size_ = size;
+        array.is_view_ = true;
+        return array;
+    }
+
+    const T& operator[](size_t i) const { return data_[i]; }
+    const T* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+    const T& front() const { return data_[0]; }
+    const T& back() const { return data_[size_ - 1]; }
+
+private:
+    void sync() {
+        if (is_view_) return;
+        data_ = owned_.data();
+        size_ = owned_.size();
+    }
+
+    std::vector<T> owned_;
+    const T* data_ = nullptr;
+    size_t size_ = 0;
+    bool is_view_ = false;
+};
+
+#endif // FLATARRAY_H_INCLUDED
@@ -0,0 +1,100 @@
+#include "Footpaths.h"
+#include "Parallel.h"
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <functional>
+
+FootpathGraph buildFootpaths(const std::vector<Stop>& stops, const StopGrid& stop_grid,
+                             const std::vector<std::vector<Transfer>>& transfers_map,
+                             double max_walk_meters, double walking_speed_mps) {
+    const uint32_t num_stops = static_cast<uint32_t>(stops.size());
+
+    // Chained walks are bounded by the time it takes to walk the radius once
+    const int32_t max_walk_seconds = static_cast<int32_t>(max_walk_meters / walking_speed_mps);
+
+    // Bounded Dijkstra from every stop over the union of radius walks and transfers. Origins
+    // are independent, so blocks of them run in parallel, each into its own edge list.
+    const size_t block_size = 256;
+    std::vector<std::vector<Footpath>> block_edges((num_stops + block_size - 1) / block_size);
+    std::vector<uint32_t> out_degree(num_stops, 0);
+
+    parallelFor(num_stops, block_size, [&](size_t begin, size_t end) {
+        typedef std::pair<int32_t, uint32_t> QueueEntry; // (duration, stop)
+        std::vector<int32_t> duration(num_stops, INT32_MAX);
+        std::vector<uint32_t> visited;
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+        std::vector<Footpath>& edges = block_edges[begin / block_size];
+
+        for (uint32_t origin = static_cast<uint32_t>(begin); origin < end; ++origin) {
+            duration[origin] = 0;
+            visited.push_back(origin);
+            queue.push({0, origin});
+            while (!queue.empty()) {
+                QueueEntry entry = queue.top();
+                queue.pop();
+                uint32_t u = entry.second;
+                if (entry.first > duration[u]) continue;
+
+                auto relax = [&](uint32_t v, int32_t walk_seconds) {
+                    int32_t arrival = duration[u] + walk_seconds;
+                    if (arrival > max_walk_seconds || arrival >= duration[v]) return;
+                    if (duration[v] == INT32_MAX) visited.push_back(v);
+                    duration[v] = arrival;
+                    queue.push({arrival, v});
+                };
+                double reach_meters = std::min(max_walk_meters, (max_walk_seconds - duration[u] + 1) * walking_speed_mps);
+                stop_grid.forEachWithin(stops[u].lat, stops[u].lon, reach_meters, [&](uint32_t v, double distance) {
+                    relax(v, static_cast<int32_t>(distance / walking_speed_mps));
+                });
+                for (const auto& transfer : transfers_map[u]) relax(transfer.to_stop_idx, transfer.duration_seconds);
+            }
+
+            // An explicit transfer is kept even when it is longer than the walking bound
+            for (const auto& transfer : transfers_map[origin]) {
+                uint32_t v = transfer.to_stop_idx;
+                if (transfer.duration_seconds >= duration[v]) continue;
+                if (duration[v] == INT32_MAX) visited.push_back(v);
+                duration[v] = transfer.duration_seconds;
+            }
+
+            std::sort(visited.begin(), visited.end());
+            size_t first_edge = edges.size();
+            for (uint32_t v : visited) {
+                if (v != origin) edges.push_back({v, duration[v]});
+                duration[v] = INT32_MAX;
+            }
+            out_degree[origin] = static_cast<uint32_t>(edges.size() - first_edge);
+            visited.clear();
+        }
+    });
+
+    // Stitch the blocks together in origin order
+    std::vector<uint32_t> out_offsets(num_stops + 1, 0);
+    for (uint32_t s = 0; s < num_stops; ++s) out_offsets[s + 1] = out_offsets[s] + out_degree[s];
+    std::vector<Footpath> out_edges;
+    out_edges.reserve(out_offsets[num_stops]);
+    for (auto& edges : block_edges) {
+        out_edges.insert(out_edges.end(), edges.begin(), edges.end());
+        std::vector<Footpath>().swap(edges);
+    }
+
+    // Transpose for "who can walk to this stop" lookups, e.g. the final walk to a destination
+    std::vector<uint32_t> in_offsets(num_stops + 1, 0);
+    for (const auto& edge : out_edges) in_offsets[edge.stop + 1]++;
+    for (uint32_t s = 0; s < num_stops; ++s) in_offsets[s + 1] += in_offsets[s];
+    std::vector<Footpath> in_edges(out_edges.size());
+    std::vector<uint32_t> fill(in_offsets.begin(), in_offsets.end() - 1);
+    for (uint32_t from = 0; from < num_stops; ++from) {
+        for (uint32_t e = out_offsets[from]; e < out_offsets[from + 1]; ++e) {
+            in_edges[fill[out_edges[e].stop]++] = {from, out_edges[e].duration_seconds};
+        }
+    }
+
+    FootpathGraph graph;
+    graph.out_offsets = std::move(out_offsets);
+    graph.out_edges = std::move(out_edges);
+    graph.in_offsets = std::move(in_offsets);
+    graph.in_edges = std::move(in_edges);
+    return graph;
+}
@@ -0,0 +1,33 @@
+#ifndef FOOTPATHS_H_INCLUDED
+#define FOOTPATHS_H_INCLUDED
+
+#include <vector>
+#include <cstdint>
+#include "DataTypes.h"
+#include "StopGrid.h"
+#include "FlatArray.h"
+
+struct Footpath { uint32_t stop; int32_t duration_seconds; };
+
+// Walking connections between stops in compressed sparse row form, in both directions.
+// The graph is transitively closed up to the walking limit: if you can walk a -> b -> c
+// within it, there is also a direct a -> c edge, so RAPTOR never has to chain footpaths.
+struct FootpathGraph {
+    FlatArray<uint32_t> out_offsets; // size num_stops + 1
+    FlatArray<Footpath> out_edges;   // stop = destination
+    FlatArray<uint32_t> in_offsets;  // size num_stops + 1
+    FlatArray<Footpath> in_edges;    // stop = origin
+
+    const Footpath* outBegin(uint32_t stop_idx) const { return out_edges.data() + out_offsets[stop_idx]; }
+    const Footpath* outEnd(uint32_t stop_idx) const { return out_edges.data() + out_offsets[stop_idx + 1]; }
+    const Footpath* inBegin(uint32_t stop_idx) const { return in_edges.data() + in_offsets[stop_idx]; }
+    const Footpath* inEnd(uint32_t stop_idx) const { return in_edges.data() + in_offsets[stop_idx + 1]; }
+};
+
+// Combines straight-line walks to every stop within max_walk_meters with the explicit
+// transfers.txt entries, and closes the result with a walking-time-bounded Dijkstra per stop.
+FootpathGraph buildFootpaths(const std::vector<Stop>& stops, const StopGrid& stop_grid,
+                             const std::vector<std::vector<Transfer>>& transfers_map,
+                             double max_walk_meters, double walking_speed_mps);
+
+#endif // FOOTPATHS_H_INCLUDED
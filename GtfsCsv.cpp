@@ -0,0 +1,122 @@
+#include "GtfsCsv.h"
+#include <cstring>
+#include <algorithm>
+#include "Parallel.h"
+
+GtfsCsvReader::GtfsCsvReader(std::string_view buffer) : data(buffer) {
+    if (data.size() >= 3 && data.compare(0, 3, "\xEF\xBB\xBF") == 0) pos = 3;
+    readRow(header);
+    for (auto& name : header) {
+        while (!name.empty() && name.front() == ' ') name.remove_prefix(1);
+        while (!name.empty() && name.back() == ' ') name.remove_suffix(1);
+    }
+}
+
+int GtfsCsvReader::column(std::string_view name) const {
+    for (size_t i = 0; i < header.size(); ++i) {
+        if (header[i] == name) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+bool GtfsCsvReader::next() {
+    while (readRow(fields)) {
+        if (fields.size() > 1 || !fields[0].empty()) return true; // skip blank lines
+    }
+    return false;
+}
+
+std::vector<std::string_view> GtfsCsvReader::splitRows(size_t count) const {
+    std::string_view rest = data.substr(std::min(pos, data.size()));
+    std::vector<std::string_view> pieces;
+    if (count <= 1) {
+        pieces.push_back(rest);
+        return pieces;
+    }
+
+    // A line break ends a row when an even number of quotes precede it: a quoted field opens
+    // and closes with one each, and "" escapes come in pairs. Quotes are counted per chunk in
+    // parallel, so each cut point knows the parity it starts from.
+    const size_t target = rest.size() / count + 1;
+    std::vector<size_t> quotes(count, 0);
+    parallelFor(count, 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            const size_t from = std::min(c * target, rest.size());
+            const size_t to = std::min(from + target, rest.size());
+            quotes[c] = static_cast<size_t>(std::count(rest.begin() + from, rest.begin() + to, '"'));
+        }
+    });
+
+    size_t start = 0;
+    size_t quotes_before = 0; // up to c * target
+    for (size_t c = 1; c <= count && start < rest.size(); ++c) {
+        quotes_before += quotes[c - 1];
+        size_t end = c * target;
+        if (c == count || end >= rest.size()) {
+            end = rest.size();
+        } else {
+            // From the chunk boundary to the first line break outside quotes
+            bool quoted = quotes_before % 2 != 0;
+            while (end < rest.size() && (quoted || rest[end] != '\n')) {
+                if (rest[end] == '"') quoted = !quoted;
+                ++end;
+            }
+            end = std::min(end + 1, rest.size());
+        }
+        if (end <= start) continue; // the previous cut already went past this chunk
+        pieces.push_back(rest.substr(start, end - start));
+        start = end;
+    }
+    return pieces;
+}
+
+bool GtfsCsvReader::readRow(std::vector<std::string_view>& out) {
+    out.clear();
+    unescaped.clear();
+    if (pos >= data.size()) return false;
+
+    const char* base = data.data();
+    const size_t size = data.size();
+    while (true) {
+        // pos may be at the end of the buffer after a trailing ',': that is an empty last field
+        std::string_view value;
+        if (pos < size && base[pos] == '"') {
+            // Quoted field: may contain commas, newlines and "" escapes
+            size_t start = ++pos;
+            bool has_escapes = false;
+            size_t end = size;
+            while (pos < size) {
+                const void* quote = std::memchr(base + pos, '"', size - pos);
+                if (!quote) { pos = size; break; }
+                size_t q = static_cast<const char*>(quote) - base;
+                if (q + 1 < size && base[q + 1] == '"') { has_escapes = true; pos = q + 2; continue; }
+                end = q;
+                pos = q + 1;
+                break;
+            }
+            value = std::string_view(base + start, end - start);
+            if (has_escapes) {
+                std::string plain;
+                plain.reserve(value.size());
+                for (size_t i = 0; i < value.size(); ++i) {
+                    plain.push_back(value[i]);
+                    if (value[i] == '"' && i + 1 < value.size() && value[i + 1] == '"') ++i;
+                }
+                unescaped.push_back(std::move(plain));
+                value = unescaped.back();
+            }
+            // Anything between the closing quote and the delimiter is ignored
+            while (pos < size && base[pos] != ',' && base[pos] != '\n' && base[pos] != '\r') ++pos;
+        } else {
+            size_t start = pos;
+            while (pos < size && base[pos] != ',' && base[pos] != '\n' && base[pos] != '\r') ++pos;
+            value = std::string_view(base + start, pos - start);
+        }
+        out.push_back(value);
+
+        if (pos < size && base[pos] == ',') { ++pos; continue; }
+        if (pos < size && base[pos] == '\r') ++pos;
+        if (pos < size && base[pos] == '\n') ++pos;
+        return true;
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef GTFSCSV_H_INCLUDED
+#define GTFSCSV_H_INCLUDED
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <deque>
+#include <charconv>
+
+// Tokenizer for GTFS CSV files. It walks one contiguous buffer and hands out fields as
+// string_views into it, so nothing is copied except quoted fields containing "" escapes.
+// Columns are looked up by header name, since GTFS does not fix their order.
+struct GtfsCsvReader {
+    std::string_view data;
+    size_t pos = 0;
+    std::vector<std::string_view> header;
+    std::vector<std::string_view> fields; // current row
+    std::deque<std::string> unescaped;    // backing storage for fields that had "" escapes
+
+    // Reads the header row; a UTF-8 byte order mark is skipped
+    explicit GtfsCsvReader(std::string_view buffer);
+
+    // Reads header-less rows (a piece from splitRows) using the header of another reader
+    GtfsCsvReader(std::string_view rows, const std::vector<std::string_view>& file_header)
+        : data(rows), header(file_header) {}
+
+    // Index of a header column, or -1 when the file does not have it
+    int column(std::string_view name) const;
+
+    // Advances to the next non-blank row; false at end of buffer
+    bool next();
+
+    // Splits the rows not read yet into at most `count` pieces that each end on a line break
+    // outside quoted fields, so they can be parsed independently.
+    std::vector<std::string_view> splitRows(size_t count) const;
+
+    // Field of the current row, empty when the column is missing or the row is short
+    std::string_view field(int col) const {
+        return (col >= 0 && static_cast<size_t>(col) < fields.size()) ? fields[col] : std::string_view();
+    }
+
+private:
+    bool readRow(std::vector<std::string_view>& out);
+};
+
+// Number parsing with std::from_chars; false on empty or malformed fields
+template <typename T>
+inline bool parseNumber(std::string_view text, T& out) {
+    while (!text.empty() && text.front() == ' ') text.remove_prefix(1);
+    while (!text.empty() && text.back() == ' ') text.remove_suffix(1);
+    if (text.empty()) return false;
+    if (text.front() == '+') text.remove_prefix(1);
+    auto result = std::from_chars(text.data(), text.data() + text.size(), out);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+#endif // GTFSCSV_H_INCLUDED
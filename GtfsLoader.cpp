@@ -0,0 +1,245 @@
+#include "GtfsLoader.h"
+#include "GtfsCsv.h"
+#include "Parallel.h"
+#include <iostream>
+#include <algorithm>
+#include "robin_hood.h"
+
+// Looks up every name in `names`; prints the first missing one and returns false
+static bool requireColumns(const GtfsCsvReader& reader, const char* file,
+                           std::initializer_list<std::pair<const char*, int*>> names) {
+    for (const auto& entry : names) {
+        *entry.second = reader.column(entry.first);
+        if (*entry.second < 0) {
+            std::cerr << file << ": missing required column '" << entry.first << "'" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool loadStops(std::string_view data, IdInterner<int>& stop_ids, std::vector<Stop>& stops) {
+    GtfsCsvReader reader(data);
+    int id_col, name_col, lat_col, lon_col;
+    if (!requireColumns(reader, "stops.txt", {{"stop_id", &id_col}, {"stop_name", &name_col},
+                                              {"stop_lat", &lat_col}, {"stop_lon", &lon_col}})) {
+        return false;
+    }
+
+    while (reader.next()) {
+        Stop s;
+        if (!parseNumber(reader.field(id_col), s.id) || !parseNumber(reader.field(lat_col), s.lat) ||
+            !parseNumber(reader.field(lon_col), s.lon)) {
+            continue;
+        }
+        s.name = std::string(reader.field(name_col));
+        uint32_t idx = stop_ids.intern(s.id);
+        if (idx == stops.size()) stops.push_back(std::move(s));
+        else stops[idx] = std::move(s);
+    }
+    return true;
+}
+
+// Stop events parsed from one piece of stop_times.txt, as fragments: runs of consecutive rows
+// of one trip, sorted by stop_sequence. A trip only spans several fragments when its rows are
+// not contiguous in the file. Trip ids are interned locally so pieces can run concurrently.
+struct StopTimeFragments {
+    IdInterner<std::string> trips;
+    std::vector<uint32_t> fragment_trip;       // local trip index per fragment
+    std::vector<uint32_t> fragment_offsets{0}; // size num_fragments + 1
+    std::vector<uint32_t> stops;
+    std::vector<int32_t> sequences;
+    std::vector<int32_t> arrivals;
+    std::vector<int32_t> departures;
+    size_t malformed_times = 0; // rows skipped for a time that is present but not H:MM:SS
+};
+
+static void parseStopTimeRows(GtfsCsvReader& reader, const int* cols, const IdInterner<int>& stop_ids,
+                              StopTimeFragments& out) {
+    const int trip_col = cols[0], arrival_col = cols[1], departure_col = cols[2], stop_col = cols[3], sequence_col = cols[4];
+
+    // Rows of the trip being read; only these are ever held as whole rows
+    std::vector<StopTime> current;
+    std::string current_trip;
+    auto flush = [&]() {
+        if (current.empty()) return;
+        auto by_sequence = [](const StopTime& a, const StopTime& b) { return a.stop_sequence < b.stop_sequence; };
+        if (!std::is_sorted(current.begin(), current.end(), by_sequence)) std::stable_sort(current.begin(), current.end(), by_sequence);
+        for (const auto& st : current) {
+            out.stops.push_back(st.stop_idx);
+            out.sequences.push_back(st.stop_sequence);
+            out.arrivals.push_back(st.arrival_time.toSeconds());
+            out.departures.push_back(st.departure_time.toSeconds());
+        }
+        out.fragment_trip.push_back(current.front().trip_idx);
+        out.fragment_offsets.push_back(static_cast<uint32_t>(out.stops.size()));
+        current.clear();
+    };
+
+    while (reader.next()) {
+        StopTime st;
+        int stop_id;
+        if (!parseNumber(reader.field(stop_col), stop_id) || !parseNumber(reader.field(sequence_col), st.stop_sequence)) {
+            continue;
+        }
+        st.stop_idx = stop_ids.find(stop_id);
+        if (st.stop_idx == IdInterner<int>::NOT_FOUND) continue; // Skip rows referring to stops missing from stops.txt
+
+        // A blank time is allowed (the stop is not a timepoint); anything else has to parse
+        std::string_view arrival_text = reader.field(arrival_col), departure_text = reader.field(departure_col);
+        bool has_arrival = Time::parse(arrival_text, st.arrival_time);
+        bool has_departure = Time::parse(departure_text, st.departure_time);
+        auto blank = [](std::string_view text) { return text.find_first_not_of(' ') == std::string_view::npos; };
+        if ((!has_arrival && !blank(arrival_text)) || (!has_departure && !blank(departure_text))) {
+            ++out.malformed_times;
+            continue;
+        }
+        if (!has_arrival && !has_departure) continue;
+        if (!has_arrival) st.arrival_time = st.departure_time;
+        if (!has_departure) st.departure_time = st.arrival_time;
+
+        std::string_view trip = reader.field(trip_col);
+        if (current.empty() || trip != current_trip) {
+            flush();
+            current_trip.assign(trip.data(), trip.size());
+            st.trip_idx = out.trips.intern(current_trip);
+        } else {
+            st.trip_idx = current.front().trip_idx;
+        }
+        current.push_back(st);
+    }
+    flush();
+}
+
+bool loadStopTimes(std::string_view data, const IdInterner<int>& stop_ids, IdInterner<std::string>& trip_ids,
+                   TripStore& trips) {
+    GtfsCsvReader reader(data);
+    int cols[5];
+    if (!requireColumns(reader, "stop_times.txt", {{"trip_id", &cols[0]}, {"arrival_time", &cols[1]},
+                                                   {"departure_time", &cols[2]}, {"stop_id", &cols[3]},
+                                                   {"stop_sequence", &cols[4]}})) {
+        return false;
+    }
+
+    // Parse newline-aligned pieces concurrently; a few pieces per thread evens out the load
+    std::vector<std::string_view> pieces = reader.splitRows(workerCount() * 4);
+    std::vector<StopTimeFragments> parsed(pieces.size());
+    parallelFor(pieces.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            GtfsCsvReader piece(pieces[i], reader.header);
+            parseStopTimeRows(piece, cols, stop_ids, parsed[i]);
+        }
+    });
+
+    // Intern trip ids piece by piece, in file order, so indices match a sequential load,
+    // and size every trip's slice of the store
+    std::vector<std::vector<uint32_t>> to_global(pieces.size());
+    std::vector<uint32_t> trip_events, trip_fragments;
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        for (const auto& trip : parsed[i].trips.ids) to_global[i].push_back(trip_ids.intern(trip));
+        trip_events.resize(trip_ids.size(), 0);
+        trip_fragments.resize(trip_ids.size(), 0);
+        const auto& piece = parsed[i];
+        for (size_t f = 0; f + 1 < piece.fragment_offsets.size(); ++f) {
+            uint32_t t = to_global[i][piece.fragment_trip[f]];
+            trip_events[t] += piece.fragment_offsets[f + 1] - piece.fragment_offsets[f];
+            trip_fragments[t]++;
+        }
+    }
+    const uint32_t num_trips = static_cast<uint32_t>(trip_ids.size());
+    trips.offsets.assign(num_trips + 1, 0);
+    for (uint32_t t = 0; t < num_trips; ++t) trips.offsets[t + 1] = trips.offsets[t] + trip_events[t];
+    trips.stops.resize(trips.offsets[num_trips]);
+    trips.arrivals.resize(trips.offsets[num_trips]);
+    trips.departures.resize(trips.offsets[num_trips]);
+
+    // Trips read in one run (the normal case) are copied straight into place
+    parallelFor(pieces.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const auto& piece = parsed[i];
+            for (size_t f = 0; f + 1 < piece.fragment_offsets.size(); ++f) {
+                uint32_t t = to_global[i][piece.fragment_trip[f]];
+                if (trip_fragments[t] != 1) continue;
+                uint32_t from = piece.fragment_offsets[f], count = piece.fragment_offsets[f + 1] - from;
+                std::copy_n(piece.stops.data() + from, count, trips.stops.data() + trips.offsets[t]);
+                std::copy_n(piece.arrivals.data() + from, count, trips.arrivals.data() + trips.offsets[t]);
+                std::copy_n(piece.departures.data() + from, count, trips.departures.data() + trips.offsets[t]);
+            }
+        }
+    });
+
+    // Trips whose rows are scattered are merged by stop_sequence
+    robin_hood::unordered_map<uint32_t, std::vector<std::pair<int32_t, uint32_t>>> scattered; // trip -> (sequence, location)
+    std::vector<std::pair<uint32_t, uint32_t>> locations; // (piece, event)
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        const auto& piece = parsed[i];
+        for (size_t f = 0; f + 1 < piece.fragment_offsets.size(); ++f) {
+            uint32_t t = to_global[i][piece.fragment_trip[f]];
+            if (trip_fragments[t] == 1) continue;
+            for (uint32_t e = piece.fragment_offsets[f]; e < piece.fragment_offsets[f + 1]; ++e) {
+                scattered[t].push_back({piece.sequences[e], static_cast<uint32_t>(locations.size())});
+                locations.push_back({static_cast<uint32_t>(i), e});
+            }
+        }
+    }
+    for (auto& entry : scattered) {
+        auto& events = entry.second;
+        std::stable_sort(events.begin(), events.end(),
+            [](const std::pair<int32_t, uint32_t>& a, const std::pair<int32_t, uint32_t>& b) { return a.first < b.first; });
+        uint32_t out = trips.offsets[entry.first];
+        for (const auto& event : events) {
+            const auto& piece = parsed[locations[event.second].first];
+            uint32_t e = locations[event.second].second;
+            trips.stops[out] = piece.stops[e];
+            trips.arrivals[out] = piece.arrivals[e];
+            trips.departures[out] = piece.departures[e];
+            ++out;
+        }
+    }
+
+    size_t malformed_times = 0;
+    for (const auto& piece : parsed) malformed_times += piece.malformed_times;
+    if (malformed_times > 0) {
+        std::cerr << "stop_times.txt: skipped " << malformed_times << " rows with malformed times" << std::endl;
+    }
+    return true;
+}
+
+bool loadTransfers(std::string_view data, const IdInterner<int>& stop_ids,
+                   std::vector<std::vector<Transfer>>& transfers_map) {
+    GtfsCsvReader reader(data);
+    int from_col, to_col;
+    if (!requireColumns(reader, "transfers.txt", {{"from_stop_id", &from_col}, {"to_stop_id", &to_col}})) {
+        return false;
+    }
+    int duration_col = reader.column("min_transfer_time");
+    if (duration_col < 0) duration_col = reader.column("transfer_time_seconds");
+    if (duration_col < 0) {
+        std::cerr << "transfers.txt: missing required column 'min_transfer_time'" << std::endl;
+        return false;
+    }
+
+    // A negative duration would break the footpath closure and the lower bounds built on it
+    size_t negative_durations = 0;
+    while (reader.next()) {
+        int from_id, to_id;
+        Transfer t;
+        if (!parseNumber(reader.field(from_col), from_id) || !parseNumber(reader.field(to_col), to_id) ||
+            !parseNumber(reader.field(duration_col), t.duration_seconds)) {
+            continue;
+        }
+        if (t.duration_seconds < 0) {
+            ++negative_durations;
+            continue;
+        }
+        t.from_stop_idx = stop_ids.find(from_id);
+        t.to_stop_idx = stop_ids.find(to_id);
+        if (t.from_stop_idx != IdInterner<int>::NOT_FOUND && t.to_stop_idx != IdInterner<int>::NOT_FOUND) {
+            transfers_map[t.from_stop_idx].push_back(t);
+        }
+    }
+    if (negative_durations > 0) {
+        std::cerr << "transfers.txt: skipped " << negative_durations << " transfers with a negative duration" << std::endl;
+    }
+    return true;
+}
@@ -0,0 +1,30 @@
+#ifndef GTFSLOADER_H_INCLUDED
+#define GTFSLOADER_H_INCLUDED
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include "DataTypes.h"
+#include "IdInterner.h"
+#include "Timetable.h"
+
+// Loaders for the GTFS tables the router uses. Each one takes the raw file contents, finds
+// its columns by header name and skips rows that are malformed or refer to unknown stops.
+// They return false, after printing which column is missing, when a required column is absent.
+
+// stops.txt: stop_id, stop_name, stop_lat, stop_lon
+bool loadStops(std::string_view data, IdInterner<int>& stop_ids, std::vector<Stop>& stops);
+
+// stop_times.txt: trip_id, arrival_time, departure_time, stop_id, stop_sequence.
+// A row with only one of the two times uses it for both. Rows are streamed straight into
+// per-trip event columns, never held as a whole; parsing runs in parallel pieces, but the
+// trip indices are the same as for a front-to-back read.
+bool loadStopTimes(std::string_view data, const IdInterner<int>& stop_ids, IdInterner<std::string>& trip_ids,
+                   TripStore& trips);
+
+// transfers.txt: from_stop_id, to_stop_id, and min_transfer_time (or transfer_time_seconds).
+// transfers_map is indexed by the origin stop and must already be sized to the stop count.
+bool loadTransfers(std::string_view data, const IdInterner<int>& stop_ids,
+                   std::vector<std::vector<Transfer>>& transfers_map);
+
+#endif // GTFSLOADER_H_INCLUDED
@@ -0,0 +1,36 @@
+#ifndef IDINTERNER_H_INCLUDED
+#define IDINTERNER_H_INCLUDED
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "robin_hood.h"
+
+// Maps external GTFS identifiers to contiguous indices, assigned in first-seen order.
+// All core structures are indexed by these; the original ids are only kept here for output.
+template <typename Key>
+struct IdInterner {
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+    uint32_t intern(const Key& key) {
+        auto it = index_of_id.find(key);
+        if (it != index_of_id.end()) return it->second;
+        uint32_t idx = static_cast<uint32_t>(ids.size());
+        index_of_id.emplace(key, idx);
+        ids.push_back(key);
+        return idx;
+    }
+
+    uint32_t find(const Key& key) const {
+        auto it = index_of_id.find(key);
+        return (it != index_of_id.end()) ? it->second : NOT_FOUND;
+    }
+
+    const Key& id(uint32_t idx) const { return ids[idx]; }
+    size_t size() const { return ids.size(); }
+
+    robin_hood::unordered_map<Key, uint32_t> index_of_id;
+    std::vector<Key> ids;
+};
+
+#endif // IDINTERNER_H_INCLUDED
@@ -0,0 +1,67 @@
+#include "Isochrone.h"
+#include <algorithm>
+#include <cmath>
+
+IsochroneRaster rasterizeIsochrone(const std::vector<std::pair<uint32_t, Time>>& reached, const StopTable& stops,
+                                   const Time& deadline, double cell_size_m,
+                                   double max_walk_meters, double walking_speed_mps) {
+    IsochroneRaster raster;
+    if (reached.empty() || cell_size_m <= 0.0) return raster;
+
+    // The grid covers every reached stop plus the farthest one can walk from it
+    double min_lat = stops.lats[reached[0].first], max_lat = min_lat;
+    double min_lon = stops.lons[reached[0].first], max_lon = min_lon;
+    for (const auto& entry : reached) {
+        min_lat = std::min(min_lat, stops.lats[entry.first]); max_lat = std::max(max_lat, stops.lats[entry.first]);
+        min_lon = std::min(min_lon, stops.lons[entry.first]); max_lon = std::max(max_lon, stops.lons[entry.first]);
+    }
+    const double meters_per_degree = 6371000.0 * M_PI / 180.0;
+    const double mid_lat = std::min(89.0, std::fabs((min_lat + max_lat) / 2.0));
+    const double pad_lat = max_walk_meters / meters_per_degree;
+    const double pad_lon = max_walk_meters / (meters_per_degree * std::cos(mid_lat * M_PI / 180.0));
+    raster.min_lat = min_lat - pad_lat;
+    raster.min_lon = min_lon - pad_lon;
+    raster.cell_lat_deg = cell_size_m / meters_per_degree;
+    raster.cell_lon_deg = cell_size_m / (meters_per_degree * std::cos(mid_lat * M_PI / 180.0));
+
+    // Keep the response coarse, whatever cell size was asked for. Rounding to whole cells can
+    // leave the first estimate just over the cap, so grow the cells until it fits.
+    double rows = 0, cols = 0;
+    auto countCells = [&] {
+        rows = std::floor((max_lat + pad_lat - raster.min_lat) / raster.cell_lat_deg) + 1;
+        cols = std::floor((max_lon + pad_lon - raster.min_lon) / raster.cell_lon_deg) + 1;
+    };
+    countCells();
+    for (double scale = std::sqrt(rows * cols / MAX_ISOCHRONE_CELLS); rows * cols > MAX_ISOCHRONE_CELLS; scale = 1.01) {
+        raster.cell_lat_deg *= scale;
+        raster.cell_lon_deg *= scale;
+        countCells();
+    }
+    raster.rows = static_cast<uint32_t>(rows);
+    raster.cols = static_cast<uint32_t>(cols);
+    raster.arrivals.assign(static_cast<size_t>(raster.rows) * raster.cols, IsochroneRaster::UNREACHED);
+
+    // Walk on from each stop to the centres of the cells around it, as far as time allows
+    for (const auto& entry : reached) {
+        const double lat = stops.lats[entry.first], lon = stops.lons[entry.first];
+        const double reach_m = std::min(max_walk_meters, (deadline - entry.second) * walking_speed_mps);
+        const double dlat = reach_m / meters_per_degree;
+        const double dlon = reach_m / (meters_per_degree * std::cos(mid_lat * M_PI / 180.0));
+        int r0 = std::max(0, static_cast<int>(std::floor((lat - dlat - raster.min_lat) / raster.cell_lat_deg)));
+        int r1 = std::min(static_cast<int>(raster.rows) - 1, static_cast<int>(std::floor((lat + dlat - raster.min_lat) / raster.cell_lat_deg)));
+        int c0 = std::max(0, static_cast<int>(std::floor((lon - dlon - raster.min_lon) / raster.cell_lon_deg)));
+        int c1 = std::min(static_cast<int>(raster.cols) - 1, static_cast<int>(std::floor((lon + dlon - raster.min_lon) / raster.cell_lon_deg)));
+        for (int r = r0; r <= r1; ++r) {
+            const double cell_lat = raster.min_lat + (r + 0.5) * raster.cell_lat_deg;
+            for (int c = c0; c <= c1; ++c) {
+                const double cell_lon = raster.min_lon + (c + 0.5) * raster.cell_lon_deg;
+                double distance = haversine(lat, lon, cell_lat, cell_lon);
+                if (distance > reach_m) continue;
+                int32_t arrival = entry.second.toSeconds() + static_cast<int32_t>(distance / walking_speed_mps);
+                int32_t& cell = raster.arrivals[static_cast<size_t>(r) * raster.cols + c];
+                if (cell == IsochroneRaster::UNREACHED || arrival < cell) cell = arrival;
+            }
+        }
+    }
+    return raster;
+}
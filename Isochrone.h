@@ -0,0 +1,33 @@
+#ifndef ISOCHRONE_H_INCLUDED
+#define ISOCHRONE_H_INCLUDED
+
+#include "DataTypes.h" // first, so M_PI is defined before <cmath> is pulled in
+#include "Network.h"
+#include <vector>
+#include <cstdint>
+
+// An isochrone on a lat/lon grid: for each cell, the earliest time its centre can be reached
+// by walking on from a reached stop. Row-major, row 0 at min_lat.
+struct IsochroneRaster {
+    static constexpr int32_t UNREACHED = -1;
+    double min_lat = 0.0, min_lon = 0.0;
+    double cell_lat_deg = 1.0, cell_lon_deg = 1.0;
+    uint32_t rows = 0, cols = 0;
+    std::vector<int32_t> arrivals; // seconds after midnight, or UNREACHED
+};
+
+// Longest travel-time budget /api/isochrone accepts: a whole service day
+const int MAX_ISOCHRONE_BUDGET_MINUTES = 24 * 60;
+
+// Largest raster rasterizeIsochrone returns; its JSON stays under about 100 KB
+const double MAX_ISOCHRONE_CELLS = 128.0 * 128.0;
+
+// Rasterises the stops reached by runIsochrone onto square cells of roughly cell_size_m
+// meters, or larger ones when the grid would exceed MAX_ISOCHRONE_CELLS; the cell size used
+// is in the result. The walk from a stop to a cell is straight-line, at most max_walk_meters
+// and never past the deadline.
+IsochroneRaster rasterizeIsochrone(const std::vector<std::pair<uint32_t, Time>>& reached, const StopTable& stops,
+                                   const Time& deadline, double cell_size_m,
+                                   double max_walk_meters, double walking_speed_mps);
+
+#endif // ISOCHRONE_H_INCLUDED
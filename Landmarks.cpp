@@ -0,0 +1,142 @@
+#include "Landmarks.h"
+#include "Parallel.h"
+#include <cmath>
+#include <queue>
+#include <functional>
+#include <climits>
+
+namespace {
+
+struct Arc { uint32_t from; uint32_t to; int32_t seconds; };
+
+// Arcs by their first stop, in compressed sparse row form
+struct Graph {
+    std::vector<uint32_t> offsets; // size num_stops + 1
+    std::vector<Arc> arcs;
+};
+
+Graph buildGraph(std::vector<Arc> arcs, size_t num_stops) {
+    Graph graph;
+    graph.offsets.assign(num_stops + 1, 0);
+    for (const Arc& arc : arcs) ++graph.offsets[arc.from + 1];
+    for (size_t s = 0; s < num_stops; ++s) graph.offsets[s + 1] += graph.offsets[s];
+    graph.arcs.resize(arcs.size());
+    std::vector<uint32_t> fill(graph.offsets.begin(), graph.offsets.end() - 1);
+    for (const Arc& arc : arcs) graph.arcs[fill[arc.from]++] = arc;
+    return graph;
+}
+
+// Seconds from `source` to every stop, saturated to 16 bits
+std::vector<uint16_t> shortestTimes(const Graph& graph, uint32_t source) {
+    std::vector<int32_t> best(graph.offsets.size() - 1, INT32_MAX);
+    using Entry = std::pair<int32_t, uint32_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    best[source] = 0;
+    queue.push({0, source});
+    while (!queue.empty()) {
+        const auto [time, stop] = queue.top();
+        queue.pop();
+        if (time != best[stop]) continue;
+        for (uint32_t e = graph.offsets[stop]; e < graph.offsets[stop + 1]; ++e) {
+            const Arc& arc = graph.arcs[e];
+            if (time + arc.seconds < best[arc.to]) {
+                best[arc.to] = time + arc.seconds;
+                queue.push({best[arc.to], arc.to});
+            }
+        }
+    }
+    std::vector<uint16_t> times(best.size());
+    for (size_t s = 0; s < best.size(); ++s) {
+        times[s] = best[s] < LandmarkTable::NO_PATH ? static_cast<uint16_t>(best[s]) : LandmarkTable::NO_PATH;
+    }
+    return times;
+}
+
+} // namespace
+
+LandmarkTable buildLandmarks(const std::vector<Stop>& stops, const Timetable& timetable,
+                             const FootpathGraph& footpaths, size_t num_landmarks) {
+    const size_t num_stops = stops.size();
+
+    // The fastest ride between consecutive stops of each pattern, and every footpath
+    std::vector<Arc> forward, backward;
+    for (uint32_t p = 0; p < timetable.patterns.size(); ++p) {
+        const RoutePattern& route = timetable.patterns[p];
+        for (uint32_t i = 0; i + 1 < route.num_stops; ++i) {
+            int32_t fastest = INT32_MAX;
+            for (uint32_t t = 0; t < route.num_trips; ++t) {
+                fastest = std::min(fastest, timetable.arrival(p, t, i + 1) - timetable.departure(p, t, i));
+            }
+            fastest = std::max(fastest, 0);
+            const uint32_t from = timetable.stop(p, i), to = timetable.stop(p, i + 1);
+            forward.push_back({from, to, fastest});
+            backward.push_back({to, from, fastest});
+        }
+    }
+    for (uint32_t s = 0; s < num_stops; ++s) {
+        for (const Footpath* walk = footpaths.outBegin(s); walk != footpaths.outEnd(s); ++walk) {
+            forward.push_back({s, walk->stop, walk->duration_seconds});
+            backward.push_back({walk->stop, s, walk->duration_seconds});
+        }
+    }
+    const Graph forward_graph = buildGraph(std::move(forward), num_stops);
+    const Graph backward_graph = buildGraph(std::move(backward), num_stops);
+
+    // Landmarks: the served stop farthest from the centre in each sector of directions. Stops
+    // on the edge of the network lie behind most journeys, which is where the bounds are tight.
+    double centre_lat = 0.0, centre_lon = 0.0;
+    size_t num_served = 0;
+    for (uint32_t s = 0; s < num_stops; ++s) {
+        if (timetable.stop_pattern_offsets[s] == timetable.stop_pattern_offsets[s + 1]) continue;
+        centre_lat += stops[s].lat;
+        centre_lon += stops[s].lon;
+        ++num_served;
+    }
+    LandmarkTable table;
+    if (num_served == 0 || num_landmarks == 0) return table;
+    centre_lat /= num_served;
+    centre_lon /= num_served;
+    const double lon_scale = std::cos(centre_lat * M_PI / 180.0);
+
+    std::vector<uint32_t> chosen(num_landmarks, UINT32_MAX);
+    std::vector<double> chosen_distance(num_landmarks, -1.0);
+    for (uint32_t s = 0; s < num_stops; ++s) {
+        if (timetable.stop_pattern_offsets[s] == timetable.stop_pattern_offsets[s + 1]) continue;
+        const double y = stops[s].lat - centre_lat;
+        const double x = (stops[s].lon - centre_lon) * lon_scale;
+        const double angle = std::atan2(y, x) + M_PI; // [0, 2 pi]
+        const size_t sector = std::min(num_landmarks - 1, static_cast<size_t>(angle / (2.0 * M_PI) * num_landmarks));
+        const double distance = x * x + y * y;
+        if (distance > chosen_distance[sector]) {
+            chosen_distance[sector] = distance;
+            chosen[sector] = s;
+        }
+    }
+    std::vector<uint32_t> landmarks;
+    for (uint32_t s : chosen) {
+        if (s != UINT32_MAX) landmarks.push_back(s);
+    }
+    const size_t count = landmarks.size();
+
+    // One search each way per landmark, all independent
+    std::vector<std::vector<uint16_t>> to_columns(count), from_columns(count);
+    parallelFor(2 * count, 1, [&](size_t begin, size_t end) {
+        for (size_t task = begin; task < end; ++task) {
+            const size_t l = task / 2;
+            if (task % 2 == 0) to_columns[l] = shortestTimes(backward_graph, landmarks[l]);
+            else from_columns[l] = shortestTimes(forward_graph, landmarks[l]);
+        }
+    });
+
+    std::vector<uint16_t> to_landmark(num_stops * count), from_landmark(num_stops * count);
+    for (size_t s = 0; s < num_stops; ++s) {
+        for (size_t l = 0; l < count; ++l) {
+            to_landmark[s * count + l] = to_columns[l][s];
+            from_landmark[s * count + l] = from_columns[l][s];
+        }
+    }
+    table.stops = std::move(landmarks);
+    table.to_landmark = std::move(to_landmark);
+    table.from_landmark = std::move(from_landmark);
+    return table;
+}
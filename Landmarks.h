@@ -0,0 +1,54 @@
+#ifndef LANDMARKS_H_INCLUDED
+#define LANDMARKS_H_INCLUDED
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include "DataTypes.h"
+#include "FlatArray.h"
+#include "Timetable.h"
+#include "Footpaths.h"
+
+// Landmark (ALT) lower bounds on travel time, ignoring schedules. For a few landmark stops
+// spread around the network this holds the shortest time from every stop to each landmark
+// and back, over the graph of footpaths and the fastest hop between consecutive stops of each
+// route pattern. No journey beats that graph, so by the triangle inequality the differences
+// bound the time between any two stops from below, and unlike a straight-line bound they
+// know which corridors have fast routes.
+//
+// Times are whole seconds in 16 bits, stored stop-major (stop * count() + landmark) so the
+// bound for one stop reads two short rows.
+struct LandmarkTable {
+    static constexpr uint16_t NO_PATH = UINT16_MAX; // out of reach, or too far to store
+
+    FlatArray<uint32_t> stops;        // landmark stop indices
+    FlatArray<uint16_t> to_landmark;  // num_stops x count()
+    FlatArray<uint16_t> from_landmark;
+
+    size_t count() const { return stops.size(); }
+
+    // Seconds any journey from one stop to another takes at least; 0 when nothing is known
+    int32_t lowerBound(uint32_t from_stop, uint32_t to_stop) const {
+        const size_t n = count();
+        const uint16_t* from_to = &to_landmark[from_stop * n];
+        const uint16_t* dest_to = &to_landmark[to_stop * n];
+        const uint16_t* from_from = &from_landmark[from_stop * n];
+        const uint16_t* dest_from = &from_landmark[to_stop * n];
+        int32_t bound = 0;
+        for (size_t l = 0; l < n; ++l) {
+            if (from_to[l] != NO_PATH && dest_to[l] != NO_PATH) bound = std::max(bound, from_to[l] - dest_to[l]);
+            if (from_from[l] != NO_PATH && dest_from[l] != NO_PATH) bound = std::max(bound, dest_from[l] - from_from[l]);
+        }
+        return bound;
+    }
+};
+
+// Landmarks built for the network: 16 keep the table at 64 bytes per stop
+const size_t NUM_LANDMARKS = 16;
+
+// Picks up to num_landmarks stops on the edge of the network, one per sector of directions
+// around its centre, and runs a shortest-path search to and from each, in parallel.
+LandmarkTable buildLandmarks(const std::vector<Stop>& stops, const Timetable& timetable,
+                             const FootpathGraph& footpaths, size_t num_landmarks);
+
+#endif // LANDMARKS_H_INCLUDED
@@ -0,0 +1,106 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path, MapAccess access) {
+    close();
+    DWORD flags = FILE_ATTRIBUTE_NORMAL | (access == MapAccess::Sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS);
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, flags, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) { CloseHandle(file); return false; }
+    if (file_size.QuadPart == 0) { CloseHandle(file); is_empty_ = true; return true; }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file); // the mapping keeps the file open
+    if (mapping == NULL) return false;
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == NULL) { CloseHandle(mapping); return false; }
+
+    mapping_ = mapping;
+    data_ = static_cast<const char*>(view);
+    size_ = static_cast<size_t>(file_size.QuadPart);
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(mapping_);
+    data_ = nullptr;
+    mapping_ = nullptr;
+    size_ = 0;
+    is_empty_ = false;
+}
+
+bool fileStamp(const std::string& path, uint64_t& size, int64_t& modified) {
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes)) return false;
+    size = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+    modified = static_cast<int64_t>((static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) |
+                                    attributes.ftLastWriteTime.dwLowDateTime);
+    return true;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path, MapAccess access) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) { ::close(fd); return false; }
+    if (st.st_size == 0) { ::close(fd); is_empty_ = true; return true; }
+
+    size_t length = static_cast<size_t>(st.st_size);
+    void* addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file referenced
+    if (addr == MAP_FAILED) return false;
+
+    // GTFS files are read front to back exactly once, so the kernel can drop pages behind
+    // the cursor; a snapshot is read all over and should stay resident
+    madvise(addr, length, access == MapAccess::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    madvise(addr, length, MADV_WILLNEED);
+
+    data_ = static_cast<const char*>(addr);
+    size_ = length;
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) munmap(const_cast<char*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+    is_empty_ = false;
+}
+
+bool fileStamp(const std::string& path, uint64_t& size, int64_t& modified) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+    size = static_cast<uint64_t>(st.st_size);
+    modified = static_cast<int64_t>(st.st_mtime);
+    return true;
+}
+
+#endif
+
+std::string joinPath(const std::string& dir, const std::string& name) {
+    if (dir.empty()) return name;
+    char last = dir.back();
+    if (last == '/' || last == '\\') return dir + name;
+    return dir + "/" + name;
+}
+
+std::string readFile(const std::string& path) {
+    MappedFile file;
+    if (!file.open(path)) return "";
+    return std::string(file.data());
+}
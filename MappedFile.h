@@ -0,0 +1,49 @@
+#ifndef MAPPEDFILE_H_INCLUDED
+#define MAPPEDFILE_H_INCLUDED
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+// How the mapping will be read, passed on to the kernel as a paging hint
+enum class MapAccess { Sequential, Random };
+
+// Read-only memory mapping of a whole file. The GTFS loaders parse straight out of the
+// mapped pages, so a file is never copied into a string before tokenizing. The mapping is
+// released when the object goes away; views handed out by data() die with it.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Maps `path`; false if it cannot be opened. Pages are prefetched either way.
+    bool open(const std::string& path, MapAccess access = MapAccess::Sequential);
+    void close();
+
+    bool isOpen() const { return data_ != nullptr || is_empty_; }
+    std::string_view data() const { return std::string_view(data_, size_); }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool is_empty_ = false; // zero-length files cannot be mapped but are valid
+#ifdef _WIN32
+    void* mapping_ = nullptr;
+#endif
+};
+
+// Joins a directory and a file name with a single separator
+std::string joinPath(const std::string& dir, const std::string& name);
+
+// Size and last modification time of a file, the time in the platform's own units; false
+// when the file cannot be found
+bool fileStamp(const std::string& path, uint64_t& size, int64_t& modified);
+
+// Reads a whole (small) file into a string, e.g. the web assets; empty if it is missing
+std::string readFile(const std::string& path);
+
+#endif // MAPPEDFILE_H_INCLUDED
@@ -0,0 +1,113 @@
+#include "Network.h"
+#include <iostream>
+#include <algorithm>
+#include "IdInterner.h"
+#include "GtfsLoader.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "Raptor.h" // walking model constants
+
+uint32_t StopTable::find(int32_t gtfs_id) const {
+    auto it = std::lower_bound(by_id.begin(), by_id.end(), gtfs_id,
+        [&](uint32_t stop_idx, int32_t id) { return ids[stop_idx] < id; });
+    return (it != by_id.end() && ids[*it] == gtfs_id) ? *it : NOT_FOUND;
+}
+
+StringTable buildStringTable(const std::vector<std::string>& strings) {
+    std::vector<uint32_t> offsets;
+    std::vector<char> chars;
+    offsets.reserve(strings.size() + 1);
+    offsets.push_back(0);
+    for (const auto& s : strings) {
+        chars.insert(chars.end(), s.begin(), s.end());
+        offsets.push_back(static_cast<uint32_t>(chars.size()));
+    }
+    StringTable table;
+    table.offsets = std::move(offsets);
+    table.chars = std::move(chars);
+    return table;
+}
+
+StopTable buildStopTable(const std::vector<Stop>& stops) {
+    std::vector<int32_t> ids;
+    std::vector<double> lats, lons;
+    std::vector<std::string> names;
+    for (const auto& stop : stops) {
+        ids.push_back(stop.id);
+        lats.push_back(stop.lat);
+        lons.push_back(stop.lon);
+        names.push_back(stop.name);
+    }
+    std::vector<uint32_t> by_id(stops.size());
+    for (uint32_t s = 0; s < by_id.size(); ++s) by_id[s] = s;
+    std::sort(by_id.begin(), by_id.end(), [&](uint32_t a, uint32_t b) { return ids[a] < ids[b]; });
+
+    StopTable table;
+    table.ids = std::move(ids);
+    table.lats = std::move(lats);
+    table.lons = std::move(lons);
+    table.names = buildStringTable(names);
+    table.by_id = std::move(by_id);
+    return table;
+}
+
+bool buildNetwork(const std::string& data_dir, Network& network) {
+    // GTFS ids are interned once here; everything below is indexed by the dense indices
+    IdInterner<int> stop_ids;
+    IdInterner<std::string> trip_ids;
+    std::vector<Stop> stops;
+    std::vector<std::vector<Transfer>> transfers_map;
+    TripStore trips;
+
+    // The GTFS files are mapped and parsed in place; each mapping is dropped once parsed
+    MappedFile stops_file;
+    if (!stops_file.open(joinPath(data_dir, "stops.txt"))) {
+        std::cerr << "Cannot open " << joinPath(data_dir, "stops.txt") << std::endl;
+        return false;
+    }
+    if (!loadStops(stops_file.data(), stop_ids, stops)) return false;
+    stops_file.close();
+
+    // Everything else only depends on the stops: parse stop_times and transfers and build
+    // the stop grid concurrently
+    MappedFile stop_times_file, transfers_file;
+    if (!stop_times_file.open(joinPath(data_dir, "stop_times.txt"))) {
+        std::cerr << "Cannot open " << joinPath(data_dir, "stop_times.txt") << std::endl;
+        return false;
+    }
+    const bool has_transfers = transfers_file.open(joinPath(data_dir, "transfers.txt")); // optional in GTFS
+    transfers_map.resize(stops.size());
+    bool stop_times_ok = true, transfers_ok = true;
+    parallelInvoke(
+        [&] { stop_times_ok = loadStopTimes(stop_times_file.data(), stop_ids, trip_ids, trips); },
+        [&] { if (has_transfers) transfers_ok = loadTransfers(transfers_file.data(), stop_ids, transfers_map); },
+        [&] { network.stop_grid = buildStopGrid(stops, MAX_WALK_DISTANCE_METERS); });
+    stop_times_file.close();
+    transfers_file.close();
+    if (!stop_times_ok || !transfers_ok) return false;
+
+    // Footpaths and the timetable are independent as well
+    std::cout << "Building walking footpaths and route patterns..." << std::endl;
+    parallelInvoke(
+        [&] {
+            network.footpaths = buildFootpaths(stops, network.stop_grid, transfers_map, MAX_WALK_DISTANCE_METERS, WALKING_SPEED_MPS);
+            std::vector<std::vector<Transfer>>().swap(transfers_map);
+        },
+        [&] {
+            network.timetable = buildTimetable(trips, stops.size());
+            trips = TripStore(); // the flat timetable is all the router needs
+            network.connections = buildConnections(network.timetable);
+        });
+    std::cout << network.footpaths.out_edges.size() << " footpaths built." << std::endl;
+    std::cout << network.timetable.patterns.size() << " route patterns built from " << trip_ids.size() << " trips." << std::endl;
+
+    // Trip-to-trip transfers and the landmark bounds need both
+    network.trip_transfers = buildTripTransfers(network.timetable, network.footpaths, stops.size());
+    std::cout << network.trip_transfers.targets.size() << " trip transfers built." << std::endl;
+    network.landmarks = buildLandmarks(stops, network.timetable, network.footpaths, NUM_LANDMARKS);
+    std::cout << network.landmarks.count() << " landmarks built." << std::endl;
+
+    network.stops = buildStopTable(stops);
+    network.trip_ids = buildStringTable(trip_ids.ids);
+    return true;
+}
@@ -0,0 +1,64 @@
+#ifndef NETWORK_H_INCLUDED
+#define NETWORK_H_INCLUDED
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include "DataTypes.h"
+#include "FlatArray.h"
+#include "Timetable.h"
+#include "StopGrid.h"
+#include "Footpaths.h"
+#include "Connections.h"
+#include "TripTransfers.h"
+#include "Landmarks.h"
+
+// Strings packed end to end: string i is chars[offsets[i], offsets[i + 1])
+struct StringTable {
+    FlatArray<uint32_t> offsets; // size count + 1
+    FlatArray<char> chars;
+
+    size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    std::string_view operator[](size_t i) const {
+        return std::string_view(chars.data() + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+};
+
+// Stops as parallel columns indexed by the dense stop index
+struct StopTable {
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+    FlatArray<int32_t> ids; // GTFS stop_id, only used for input and output
+    FlatArray<double> lats;
+    FlatArray<double> lons;
+    StringTable names;
+    FlatArray<uint32_t> by_id; // stop indices sorted by GTFS id, for find()
+
+    size_t size() const { return ids.size(); }
+
+    // Dense index of a GTFS stop_id, or NOT_FOUND
+    uint32_t find(int32_t gtfs_id) const;
+};
+
+// Everything the server needs to answer queries. It is immutable once built, and every
+// array is flat, so it can be written to and used in place from a snapshot (Snapshot.h).
+struct Network {
+    StopTable stops;
+    StringTable trip_ids; // GTFS trip_id by trip index
+    Timetable timetable;
+    StopGrid stop_grid;
+    FootpathGraph footpaths;
+    ConnectionTable connections;
+    TripTransferGraph trip_transfers;
+    LandmarkTable landmarks;
+};
+
+StringTable buildStringTable(const std::vector<std::string>& strings);
+StopTable buildStopTable(const std::vector<Stop>& stops);
+
+// Parses the GTFS files in data_dir and runs all preprocessing. Returns false, after
+// printing the reason, when a required file or column is missing.
+bool buildNetwork(const std::string& data_dir, Network& network);
+
+#endif // NETWORK_H_INCLUDED
@@ -0,0 +1,100 @@
+#ifndef PARALLEL_H_INCLUDED
+#define PARALLEL_H_INCLUDED
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+
+// Number of threads used for parallel work, the caller included
+inline unsigned workerCount() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+// Threads that live as long as the process and run submitted jobs in order. Keeping them
+// alive keeps their thread_local state too, so the router workspaces they build for one
+// request are reused by the next instead of being allocated per call.
+class WorkerPool {
+public:
+    explicit WorkerPool(unsigned num_threads);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    size_t size() const { return threads_.size(); }
+    void submit(std::function<void()> job);
+
+private:
+    void run();
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::function<void()>> jobs_;
+    std::vector<std::thread> threads_;
+    bool stopping_ = false;
+};
+
+// The process-wide pool with workerCount() - 1 threads (callers of parallelFor work as well).
+// Created on first use; the server touches it at startup so no request pays for that.
+WorkerPool& workerPool();
+
+// Calls fn(begin, end) for consecutive blocks of at most `grain` items covering [0, count).
+// Blocks are handed out dynamically to the calling thread and the pool workers, so uneven
+// blocks balance out; callers that need a deterministic result write each block's output to
+// its own slot. The caller only waits for blocks, never for queued helpers, so a job running
+// on the pool may call parallelFor again without deadlocking.
+template <typename Fn>
+void parallelFor(size_t count, size_t grain, Fn&& fn) {
+    if (count == 0) return;
+    grain = std::max<size_t>(grain, 1);
+    const size_t blocks = (count + grain - 1) / grain;
+    WorkerPool& pool = workerPool();
+    const size_t helpers = std::min(pool.size(), blocks - 1);
+    if (helpers == 0) {
+        for (size_t b = 0; b < count; b += grain) fn(b, std::min(count, b + grain));
+        return;
+    }
+
+    // Shared with the helpers, which may start after the caller has returned: they then find
+    // no block left and never touch fn
+    struct State {
+        std::atomic<size_t> next_block{0};
+        size_t done_blocks = 0;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto state = std::make_shared<State>();
+    auto work = [state, blocks, count, grain, &fn]() {
+        size_t done = 0;
+        for (size_t b = state->next_block++; b < blocks; b = state->next_block++) {
+            fn(b * grain, std::min(count, (b + 1) * grain));
+            ++done;
+        }
+        if (done == 0) return;
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->done_blocks += done;
+        if (state->done_blocks == blocks) state->finished.notify_all();
+    };
+    for (size_t h = 0; h < helpers; ++h) pool.submit(work);
+    work();
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&] { return state->done_blocks == blocks; });
+}
+
+// Runs independent tasks concurrently on the pool and waits for all of them
+template <typename... Tasks>
+void parallelInvoke(Tasks&&... tasks) {
+    std::function<void()> jobs[] = {std::function<void()>(std::forward<Tasks>(tasks))...};
+    parallelFor(sizeof...(tasks), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) jobs[i]();
+    });
+}
+
+#endif // PARALLEL_H_INCLUDED
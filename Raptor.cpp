@@ -2,148 +2,635 @@
 #include <vector>
 #include <string>
 //#include <map>
-#include <set>
 #include <algorithm>
+#include <functional>
 #include "Raptor.h"
 #include "DataTypes.h"
-#include <unordered_map>
-#include "robin_hood.h"
-const double WALKING_SPEED_MPS = 1.4;
-const double MAX_WALK_DISTANCE_METERS = 1500;
-
-void merge(std::vector<Journey>& profile, const Journey& new_journey) {
-    for (const auto& existing : profile) {
-        if (existing.arrival_time <= new_journey.arrival_time && existing.trips <= new_journey.trips) {
-            return;
-        }
-    }
-    profile.erase(std::remove_if(profile.begin(), profile.end(),
-        [&](const Journey& existing) {
-            return new_journey.arrival_time <= existing.arrival_time && new_journey.trips <= existing.trips;
-        }),
-    profile.end());
-    profile.push_back(new_journey);
-}
+#include "Parallel.h"
 
-void runMultiCriteriaRaptor(int start_stop_id, int end_stop_id, const Time& start_time,
-                            const robin_hood::unordered_map<int, Stop>& stops,
-                            const robin_hood::unordered_map<int, std::vector<Transfer>>& transfers_map,
-                            const robin_hood::unordered_map<std::string, std::vector<StopTime>>& trips_map,
-                            const robin_hood::unordered_map<int, std::vector<std::string>>& routes_serving_stop,
-                            const robin_hood::unordered_map<std::string, robin_hood::unordered_map<int, int>>& trip_stop_indices,
-                            robin_hood::unordered_map<int, std::vector<Journey>>& final_profiles,
-                            robin_hood::unordered_map<int, robin_hood::unordered_map<int, Journey>>& predecessors) {
+// Journeys that are Pareto-optimal in arrival time and number of trips. No two share a trip
+// count, so the bag fits inline; entries are kept by increasing trips, which makes arrivals
+// strictly decrease, and adding a journey is one pass: find its slot, check the entry before
+// it, and drop the run of later-arriving entries it replaces.
+struct ParetoBag {
+    static constexpr int CAPACITY = Journey::MAX_TRIP_COUNT + 1;
 
-    const int MAX_TRIPS = 5;
-    std::vector<robin_hood::unordered_map<int, std::vector<Journey>>> profiles_by_round(MAX_TRIPS + 1);
+    Journey journeys[CAPACITY];
+    int32_t arrivals[CAPACITY]; // journeys[i].arrival_time, packed for the scans
+    int trips[CAPACITY];        // journeys[i].trips()
+    int count = 0;
 
-    // Round 0: Initialize
-    merge(profiles_by_round[0][start_stop_id], {start_time, 0, start_time, -1, "Start"});
-    const Stop& start_stop_details = stops.at(start_stop_id);
-    for (const auto& stop_pair : stops) {
-        double distance = haversine(start_stop_details.lat, start_stop_details.lon, stop_pair.second.lat, stop_pair.second.lon);
-        if (distance <= MAX_WALK_DISTANCE_METERS && stop_pair.first != start_stop_id) {
-            int walk_duration_seconds = static_cast<int>(distance / WALKING_SPEED_MPS);
-            Journey j = {Time::fromSeconds(start_time.toSeconds() + walk_duration_seconds), 0, start_time, start_stop_id, "Walk"};
-            merge(profiles_by_round[0][stop_pair.first], j);
+    void clear() { count = 0; }
+    const Journey* begin() const { return journeys; }
+    const Journey* end() const { return journeys + count; }
+
+    // Adds the journey unless one with no more trips arrives no later; returns whether it did
+    bool add(const Journey& journey) {
+        const int32_t arrival = journey.arrival_time.toSeconds();
+        const int journey_trips = journey.trips();
+        int slot = 0;
+        while (slot < count && trips[slot] <= journey_trips) ++slot;
+        if (slot > 0 && arrivals[slot - 1] <= arrival) return false;
+        if (slot > 0 && trips[slot - 1] == journey_trips) --slot;
+        int kept = slot; // first entry arriving earlier, which stays
+        while (kept < count && arrivals[kept] >= arrival) ++kept;
+        if (kept == slot) { // nothing replaced: make room
+            std::copy_backward(journeys + slot, journeys + count, journeys + count + 1);
+            std::copy_backward(arrivals + slot, arrivals + count, arrivals + count + 1);
+            std::copy_backward(trips + slot, trips + count, trips + count + 1);
+            ++count;
+        } else if (kept > slot + 1) {
+            std::copy(journeys + kept, journeys + count, journeys + slot + 1);
+            std::copy(arrivals + kept, arrivals + count, arrivals + slot + 1);
+            std::copy(trips + kept, trips + count, trips + slot + 1);
+            count -= kept - slot - 1;
+        }
+        journeys[slot] = journey;
+        arrivals[slot] = arrival;
+        trips[slot] = journey_trips;
+        return true;
+    }
+};
+
+// Per-round labels stored densely as round * num_stops + stop. Every slot carries the epoch of
+// the query that last wrote it, so a new query only bumps the epoch instead of clearing or
+// reallocating anything. One label per (round, stop) is enough: all labels of round k have
+// k trips, so their Pareto bag collapses to the earliest arrival.
+struct RoundLabels {
+    std::vector<Journey> labels;
+    std::vector<uint32_t> stamps;
+    std::vector<uint32_t> touched[MAX_TRIPS + 1]; // stops holding a label, per round
+    uint32_t epoch = 0;
+    size_t num_stops = 0;
+
+    void startQuery(size_t stop_count) {
+        if (stop_count != num_stops) {
+            num_stops = stop_count;
+            labels.assign((MAX_TRIPS + 1) * num_stops, Journey());
+            stamps.assign((MAX_TRIPS + 1) * num_stops, 0);
+            epoch = 0;
+        }
+        if (++epoch == 0) { // wrapped around: stale stamps could look current again
+            std::fill(stamps.begin(), stamps.end(), 0);
+            epoch = 1;
+        }
+        for (auto& list : touched) list.clear();
+    }
+
+    bool has(int k, uint32_t stop) const { return stamps[k * num_stops + stop] == epoch; }
+    const Journey& get(int k, uint32_t stop) const { return labels[k * num_stops + stop]; }
+    bool beats(int k, uint32_t stop, const Time& arrival) const { return !has(k, stop) || arrival < get(k, stop).arrival_time; }
+
+    // Local pruning of trip arrivals: true when a label of this stop with fewer trips arrives
+    // no later and has been walked on from already, so this one can add nothing. Walk labels
+    // do not count, since walks do not chain.
+    bool coveredByFewer(int k, uint32_t stop, const Time& arrival) const {
+        for (int fewer = 0; fewer < k; ++fewer) {
+            if (has(fewer, stop) && get(fewer, stop).arrival_time <= arrival && get(fewer, stop).kind() != LegKind::Walk) return true;
+        }
+        return false;
+    }
+
+    // Stores the label and reports whether it beats every label of this stop with fewer trips.
+    // Only those rounds count: labels of later rounds may be left over from a later departure
+    // of a range query, and arriving earlier there does not make fewer trips useless.
+    bool set(int k, uint32_t stop, const Journey& journey) {
+        size_t slot = k * num_stops + stop;
+        if (stamps[slot] != epoch) {
+            stamps[slot] = epoch;
+            touched[k].push_back(stop);
+        }
+        labels[slot] = journey;
+        for (int fewer = 0; fewer < k; ++fewer) {
+            if (has(fewer, stop) && get(fewer, stop).arrival_time <= journey.arrival_time) return false;
+        }
+        return true;
+    }
+};
+
+// Stops whose best arrival improved in the current round: a bitset for O(1) deduplication
+// plus a compact list so that clearing and iterating only touch the marked stops.
+struct MarkedStops {
+    std::vector<uint64_t> bits;
+    std::vector<uint32_t> list;
+
+    void resize(size_t num_stops) {
+        if (bits.size() != (num_stops + 63) / 64) bits.assign((num_stops + 63) / 64, 0);
+        clear();
+    }
+    void mark(uint32_t stop) {
+        uint64_t mask = uint64_t(1) << (stop & 63);
+        if (bits[stop >> 6] & mask) return;
+        bits[stop >> 6] |= mask;
+        list.push_back(stop);
+    }
+    void clear() {
+        for (uint32_t stop : list) bits[stop >> 6] = 0;
+        list.clear();
+    }
+    bool empty() const { return list.empty(); }
+};
+
+// Route patterns to scan in the current round, each queued once with the earliest
+// position at which one of the marked stops lets us board it.
+struct RouteQueue {
+    static constexpr uint32_t NOT_QUEUED = UINT32_MAX;
+    std::vector<uint32_t> board_position; // per pattern
+    std::vector<uint32_t> routes;
+
+    void resize(size_t num_patterns) {
+        if (board_position.size() != num_patterns) board_position.assign(num_patterns, NOT_QUEUED);
+        clear();
+    }
+    void push(uint32_t pattern, uint32_t position) {
+        uint32_t& current = board_position[pattern];
+        if (current == NOT_QUEUED) routes.push_back(pattern);
+        if (position < current) current = position;
+    }
+    void clear() {
+        for (uint32_t pattern : routes) board_position[pattern] = NOT_QUEUED;
+        routes.clear();
+    }
+};
+
+// Target pruning for searches with one destination: a label arriving no earlier than the
+// destination is already reached with no more trips only leads to dominated journeys.
+// bound[k] is the earliest arrival at the destination with at most k trips, final walk included.
+// Range queries do without: a label pruned for one departure is missing when an earlier
+// departure could have reused it, which costs more than the pruning saves.
+//
+// Optionally (A*-style) a label is judged by its arrival plus a lower bound on the time still
+// needed: the straight-line distance to the destination at the fastest speed in the network.
+struct TargetBound {
+    static constexpr uint32_t NONE = UINT32_MAX;
+    uint32_t end_stop = NONE;
+    Time bound[MAX_TRIPS + 1];
+    std::vector<int32_t> walk_to_end; // per stop, if stamped
+    std::vector<uint32_t> stamps;
+    uint32_t epoch = 0;
+
+    double seconds_per_meter = 0;      // 0 when the distance bound is off
+    std::vector<double> points;        // per stop: position on the unit sphere (x, y, z)
+    double end_point[3] = {};
+    const LandmarkTable* landmarks = nullptr; // null when the landmark bound is off
+    mutable std::vector<int32_t> remaining;   // per stop: remainingFrom, if stamped
+    mutable std::vector<uint32_t> remaining_stamps;
+
+    void clear() { end_stop = NONE; }
+    void set(uint32_t end_stop_idx, const StopTable& stop_table, const FootpathGraph& footpaths, double max_speed_mps,
+             const LandmarkTable* landmark_table) {
+        const size_t num_stops = stop_table.size();
+        if (stamps.size() != num_stops) {
+            walk_to_end.assign(num_stops, 0);
+            stamps.assign(num_stops, 0);
+            remaining.assign(num_stops, 0);
+            remaining_stamps.assign(num_stops, 0);
+            epoch = 0;
+        }
+        if (++epoch == 0) {
+            std::fill(stamps.begin(), stamps.end(), 0);
+            std::fill(remaining_stamps.begin(), remaining_stamps.end(), 0);
+            epoch = 1;
+        }
+        end_stop = end_stop_idx;
+        landmarks = landmark_table && landmark_table->count() > 0 ? landmark_table : nullptr;
+        seconds_per_meter = max_speed_mps > 0 ? 1.0 / max_speed_mps : 0;
+        if (seconds_per_meter > 0) {
+            if (points.size() != 3 * num_stops) {
+                points.resize(3 * num_stops);
+                for (size_t s = 0; s < num_stops; ++s) {
+                    double lat = stop_table.lats[s] * M_PI / 180.0, lon = stop_table.lons[s] * M_PI / 180.0;
+                    points[3 * s] = cos(lat) * cos(lon);
+                    points[3 * s + 1] = cos(lat) * sin(lon);
+                    points[3 * s + 2] = sin(lat);
+                }
+            }
+            std::copy(&points[3 * end_stop_idx], &points[3 * end_stop_idx] + 3, end_point);
+        }
+        std::fill(bound, bound + MAX_TRIPS + 1, Time(INT32_MAX));
+        walk_to_end[end_stop_idx] = 0;
+        stamps[end_stop_idx] = epoch;
+        for (const Footpath* walk = footpaths.inBegin(end_stop_idx); walk != footpaths.inEnd(end_stop_idx); ++walk) {
+            walk_to_end[walk->stop] = walk->duration_seconds;
+            stamps[walk->stop] = epoch;
+        }
+    }
+
+    bool bounded() const { return seconds_per_meter > 0 || landmarks; }
+
+    // Seconds any journey from `stop` still needs at least. The chord through the earth is no
+    // longer than the great-circle distance, and much cheaper to compute. The landmark bound
+    // costs a few dozen loads, so it is worked out once per stop and query.
+    int32_t remainingFrom(uint32_t stop) const {
+        int32_t seconds = 0;
+        if (seconds_per_meter > 0) {
+            const double* p = &points[3 * stop];
+            double dx = p[0] - end_point[0], dy = p[1] - end_point[1], dz = p[2] - end_point[2];
+            seconds = static_cast<int32_t>(6371000.0 * sqrt(dx * dx + dy * dy + dz * dz) * seconds_per_meter);
+        }
+        if (landmarks) {
+            if (remaining_stamps[stop] != epoch) {
+                remaining[stop] = landmarks->lowerBound(stop, end_stop);
+                remaining_stamps[stop] = epoch;
+            }
+            seconds = std::max(seconds, remaining[stop]);
         }
+        return seconds;
+    }
+
+    // Called for every label stored in round k
+    void reached(int k, uint32_t stop, const Time& arrival) {
+        if (end_stop == NONE || stamps[stop] != epoch) return;
+        Time at_end = arrival + walk_to_end[stop];
+        for (int more = k; more <= MAX_TRIPS && at_end < bound[more]; ++more) bound[more] = at_end;
+    }
+    bool prunes(int k, uint32_t stop, const Time& arrival) const {
+        if (end_stop == NONE || bound[k].toSeconds() == INT32_MAX) return false;
+        return bound[k] <= arrival || (bounded() && bound[k] <= arrival + remainingFrom(stop));
+    }
+};
+
+struct TripArrival { uint32_t stop; Time arrival_time; Time departure_time; };
+
+// Everything one RAPTOR search writes to; kept per thread and reused across queries
+struct RaptorWorkspace {
+    RoundLabels rounds;
+    MarkedStops marked;
+    MarkedStops reached_by_trip; // stops given a trip label in the current round
+    RouteQueue route_queue;
+    std::vector<TripArrival> reached_this_round;
+    std::vector<TripArrival> walk_sources; // trip arrivals hidden behind an older walk label
+    std::vector<uint32_t> scratch_stops;   // per-stop scratch for reading results off the labels
+    ParetoBag end_profile;                 // Pareto bag of the destination
+    TargetBound target;
+
+    // Searches prune against `end_stop_idx` until the next startQuery
+    void setTarget(uint32_t end_stop_idx, const StopTable& stops, const FootpathGraph& footpaths, double max_speed_mps,
+                   const LandmarkTable* landmarks) {
+        target.set(end_stop_idx, stops, footpaths, max_speed_mps, landmarks);
+    }
+    void startQuery(size_t num_stops, size_t num_patterns) {
+        target.clear();
+        rounds.startQuery(num_stops);
+        marked.resize(num_stops);
+        reached_by_trip.resize(num_stops);
+        route_queue.resize(num_patterns);
+    }
+};
+
+// The workspace of the calling thread, shared by all query types
+static RaptorWorkspace& threadWorkspace() {
+    thread_local RaptorWorkspace ws;
+    return ws;
+}
+
+// One RAPTOR search from start_stop_idx departing at start_time. Labels already in the
+// workspace are kept and only improved on, which is what lets range queries reuse the
+// labels of later departures. Nothing arriving after arrival_limit is labelled.
+static void runRounds(uint32_t start_stop_idx, const Time& start_time, const FootpathGraph& footpaths,
+                      const Timetable& timetable, RaptorWorkspace& ws,
+                      const Time& arrival_limit = Time(INT32_MAX)) {
+    RoundLabels& rounds = ws.rounds;
+    MarkedStops& marked = ws.marked;
+    RouteQueue& route_queue = ws.route_queue;
+    TargetBound& target = ws.target;
+    marked.clear();
+
+    // Round 0: Initialize
+    const int start = static_cast<int>(start_stop_idx);
+    if (rounds.beats(0, start_stop_idx, start_time)) {
+        rounds.set(0, start_stop_idx, Journey(start_time, start_time, 0, -1, LegKind::Start));
+        target.reached(0, start_stop_idx, start_time);
+        marked.mark(start_stop_idx);
     }
-    if (transfers_map.count(start_stop_id)) {
-        for (const auto& transfer : transfers_map.at(start_stop_id)) {
-            Journey j = {Time::fromSeconds(start_time.toSeconds() + transfer.duration_seconds), 0, start_time, start_stop_id, "Walk"};
-            merge(profiles_by_round[0][transfer.to_stop_id], j);
+    for (const Footpath* walk = footpaths.outBegin(start_stop_idx); walk != footpaths.outEnd(start_stop_idx); ++walk) {
+        Time arrival = start_time + walk->duration_seconds;
+        if (arrival <= arrival_limit && rounds.beats(0, walk->stop, arrival) && !target.prunes(0, walk->stop, arrival) &&
+            rounds.set(0, walk->stop, Journey(arrival, start_time, 0, start, LegKind::Walk))) {
+            target.reached(0, walk->stop, arrival);
+            marked.mark(walk->stop);
         }
     }
 
     // RAPTOR Rounds
-    for (int k = 1; k <= MAX_TRIPS; ++k) {
-        robin_hood::unordered_map<int, std::vector<Journey>> reached_this_round;
-        for (const auto& pair : profiles_by_round[k - 1]) {
-            int stop_id = pair.first;
-            if (routes_serving_stop.count(stop_id)) {
-                for (const auto& trip_id : routes_serving_stop.at(stop_id)) {
-
-                    const auto& schedule = trips_map.at(trip_id);
-                    int boarding_stop_seq = -1;
-                    // Instant lookup instead of a loop
-                    if (trip_stop_indices.count(trip_id) && trip_stop_indices.at(trip_id).count(stop_id)) {
-                        boarding_stop_seq = trip_stop_indices.at(trip_id).at(stop_id);
-                    }
+    // Stop as soon as a round improves nothing, there is nothing left to board from
+    for (int k = 1; k <= MAX_TRIPS && !marked.empty(); ++k) {
+        // Queue every route pattern serving a stop improved in the previous round
+        route_queue.clear();
+        for (uint32_t stop_idx : marked.list) {
+            for (const PatternStop* ps = timetable.patternsAtBegin(stop_idx); ps != timetable.patternsAtEnd(stop_idx); ++ps) {
+                route_queue.push(ps->pattern, ps->position);
+            }
+        }
+        marked.clear();
 
-                    if (boarding_stop_seq != -1) {
-                        Journey current_trip_journey;
-                        current_trip_journey.from_stop_id = -1;
-                        for (size_t i = boarding_stop_seq; i < schedule.size(); ++i) {
-                            const auto& stop_time = schedule[i];
-                            if (profiles_by_round[k - 1].count(stop_time.stop_id)) {
-                                for (const auto& prev_journey : profiles_by_round[k-1].at(stop_time.stop_id)) {
-                                    if (prev_journey.arrival_time <= stop_time.departure_time) {
-                                        if (current_trip_journey.from_stop_id == -1 || prev_journey.arrival_time < current_trip_journey.arrival_time) {
-                                            current_trip_journey = prev_journey;
-                                        }
-                                    }
-                                }
-                            }
-                            if (current_trip_journey.from_stop_id != -1) {
-                                int predecessor_id = (i > static_cast<size_t>(boarding_stop_seq)) ? schedule[i-1].stop_id : current_trip_journey.from_stop_id;
-                                Journey new_journey = {stop_time.arrival_time, k, current_trip_journey.departure_time, predecessor_id, "Trip " + trip_id};
-                                merge(reached_this_round[stop_time.stop_id], new_journey);
+        // Scan each queued route once, hopping onto an earlier trip whenever we can catch one
+        for (uint32_t p : route_queue.routes) {
+            const RoutePattern& route = timetable.patterns[p];
+            const uint32_t* route_stops = &timetable.pattern_stops[route.first_stop];
+            uint32_t current_trip = route.num_trips; // not boarded yet
+            const int32_t* trip_arrivals = nullptr;
+            const int32_t* trip_departures = nullptr;
+            Time boarding_departure;
+            int32_t boarding_stop = -1;
+
+            for (uint32_t i = route_queue.board_position[p]; i < route.num_stops; ++i) {
+                uint32_t stop_idx = route_stops[i];
+                if (current_trip != route.num_trips && Time(trip_arrivals[i]) <= arrival_limit) {
+                    const Time arrival(trip_arrivals[i]);
+                    const bool improves = rounds.beats(k, stop_idx, arrival);
+                    // A walk label this early in the round is left over from a later departure of
+                    // a range query. Walks do not chain, so still walk on from the trip.
+                    const bool behind_walk = !improves && rounds.get(k, stop_idx).kind() == LegKind::Walk;
+                    if ((improves || behind_walk) && !target.prunes(k, stop_idx, arrival) && !rounds.coveredByFewer(k, stop_idx, arrival)) {
+                        if (improves) {
+                            if (rounds.set(k, stop_idx, Journey(arrival, boarding_departure, k, boarding_stop, LegKind::Trip, route.first_trip + current_trip))) {
+                                marked.mark(stop_idx);
                             }
+                            target.reached(k, stop_idx, arrival);
+                            ws.reached_by_trip.mark(stop_idx);
+                        } else {
+                            ws.walk_sources.push_back({stop_idx, arrival, boarding_departure});
                         }
                     }
                 }
+
+                if (!rounds.has(k - 1, stop_idx)) continue;
+                const Journey& boarding = rounds.get(k - 1, stop_idx);
+                int32_t ready_time = boarding.arrival_time.toSeconds();
+                if (current_trip != route.num_trips && trip_departures[i] < ready_time) continue;
+
+                // Earliest trip of this pattern we can still catch here
+                uint32_t catchable = timetable.earliestTrip(p, i, ready_time, current_trip);
+                if (catchable < current_trip) {
+                    current_trip = catchable;
+                    trip_arrivals = &timetable.arrivals[timetable.event(p, current_trip, 0)];
+                    trip_departures = &timetable.departures[timetable.event(p, current_trip, 0)];
+                    boarding_departure = boarding.departure_time;
+                    boarding_stop = static_cast<int32_t>(stop_idx);
+                }
             }
         }
 
-        for (const auto& pair : reached_this_round) {
-            for (const auto& journey : pair.second) {
-                merge(profiles_by_round[k][pair.first], journey);
-                if (transfers_map.count(pair.first)) {
-                    for (const auto& transfer : transfers_map.at(pair.first)) {
-                        Journey transfer_journey = { Time::fromSeconds(journey.arrival_time.toSeconds() + transfer.duration_seconds), journey.trips, journey.departure_time, pair.first, "Walk" };
-                        merge(profiles_by_round[k][transfer.to_stop_id], transfer_journey);
-                    }
+        // Footpaths are only taken right after a trip (the graph is transitively closed, so one
+        // walk is enough). Relax them from a snapshot of the trip arrivals before any walking
+        // label can overwrite one of them.
+        ws.reached_this_round.swap(ws.walk_sources);
+        ws.walk_sources.clear();
+        for (uint32_t stop_idx : ws.reached_by_trip.list) {
+            const Journey& journey = rounds.get(k, stop_idx);
+            ws.reached_this_round.push_back({stop_idx, journey.arrival_time, journey.departure_time});
+        }
+        ws.reached_by_trip.clear();
+        for (const auto& reached : ws.reached_this_round) {
+            for (const Footpath* walk = footpaths.outBegin(reached.stop); walk != footpaths.outEnd(reached.stop); ++walk) {
+                Time arrival = reached.arrival_time + walk->duration_seconds;
+                if (arrival <= arrival_limit && rounds.beats(k, walk->stop, arrival) && !target.prunes(k, walk->stop, arrival) &&
+                    rounds.set(k, walk->stop, Journey(arrival, reached.departure_time, k, static_cast<int32_t>(reached.stop), LegKind::Walk))) {
+                    target.reached(k, walk->stop, arrival);
+                    marked.mark(walk->stop);
                 }
             }
         }
     }
+}
 
-    // --- NEW, EFFICIENT FINALIZATION LOGIC ---
-    robin_hood::unordered_map<int, std::vector<Journey>> temp_final_profiles;
+// Best arrival at end_stop_idx with exactly k trips, including a final walk; false if none
+static bool arrivalAt(uint32_t end_stop_idx, int k, const FootpathGraph& footpaths, const RoundLabels& rounds, Journey& best) {
+    bool found = false;
+    if (rounds.has(k, end_stop_idx)) {
+        best = rounds.get(k, end_stop_idx);
+        found = true;
+    }
+    for (const Footpath* walk = footpaths.inBegin(end_stop_idx); walk != footpaths.inEnd(end_stop_idx); ++walk) {
+        if (!rounds.has(k, walk->stop)) continue;
+        const Journey& journey = rounds.get(k, walk->stop);
+        Time arrival = journey.arrival_time + walk->duration_seconds;
+        if (found && !(arrival < best.arrival_time)) continue;
+        best = Journey(arrival, journey.departure_time, journey.trips(), static_cast<int32_t>(walk->stop), LegKind::Walk);
+        found = true;
+    }
+    return found;
+}
+
+// Copies the labels a journey to end_stop_idx was built from, in the shape reconstructPath expects
+static void collectPredecessors(uint32_t start_stop_idx, const Journey& final_journey, const RoundLabels& rounds,
+                                JourneyLegs& predecessors) {
+    Journey journey = final_journey;
+    for (int legs = 0; legs < MAX_LEGS && journey.kind() != LegKind::Start; ++legs) {
+        int prev_stop = journey.from_stop_idx;
+        int prev_trips = journey.trips() - (journey.kind() == LegKind::Trip ? 1 : 0);
+        if (prev_stop < 0 || !rounds.has(prev_trips, static_cast<uint32_t>(prev_stop))) break;
+        journey = rounds.get(prev_trips, static_cast<uint32_t>(prev_stop));
+        predecessors.set(static_cast<uint32_t>(prev_stop), journey);
+        if (static_cast<uint32_t>(prev_stop) == start_stop_idx) break;
+    }
+}
+
+void runMultiCriteriaRaptor(uint32_t start_stop_idx, uint32_t end_stop_idx, const Time& start_time,
+                            const StopTable& stops,
+                            const FootpathGraph& footpaths,
+                            const Timetable& timetable,
+                            std::vector<ProfileJourney>& journeys,
+                            double lower_bound_speed_mps,
+                            const LandmarkTable* landmarks) {
+
+    // Reused across queries on the same server thread
+    RaptorWorkspace& ws = threadWorkspace();
+    ws.startQuery(stops.size(), timetable.patterns.size());
+    ws.setTarget(end_stop_idx, stops, footpaths, lower_bound_speed_mps, landmarks);
+    runRounds(start_stop_idx, start_time, footpaths, timetable, ws);
+
+    // The destination's Pareto bag, from its own labels and the final walks to it
+    ParetoBag& at_end = ws.end_profile;
+    at_end.clear();
     for (int k = 0; k <= MAX_TRIPS; ++k) {
-        for (const auto& profile_pair : profiles_by_round[k]) {
-            int stop_id = profile_pair.first;
-            for (const auto& journey : profile_pair.second) {
-                merge(temp_final_profiles[stop_id], journey);
+        Journey journey;
+        if (arrivalAt(end_stop_idx, k, footpaths, ws.rounds, journey)) at_end.add(journey);
+    }
+
+    // Only the labels each journey was built from are copied out
+    for (const Journey& journey : at_end) {
+        journeys.emplace_back();
+        journeys.back().journey = journey;
+        collectPredecessors(start_stop_idx, journey, ws.rounds, journeys.back().predecessors);
+    }
+}
+
+double maxTravelSpeed(const StopTable& stops, const FootpathGraph& footpaths, const Timetable& timetable) {
+    auto meters = [&](uint32_t a, uint32_t b) { return haversine(stops.lats[a], stops.lons[a], stops.lats[b], stops.lons[b]); };
+    double fastest = WALKING_SPEED_MPS;
+    std::vector<double> hop_meters;
+    for (uint32_t p = 0; p < timetable.patterns.size(); ++p) {
+        const RoutePattern& route = timetable.patterns[p];
+        hop_meters.resize(route.num_stops);
+        for (uint32_t i = 0; i + 1 < route.num_stops; ++i) hop_meters[i] = meters(timetable.stop(p, i), timetable.stop(p, i + 1));
+        for (uint32_t t = 0; t < route.num_trips; ++t) {
+            for (uint32_t i = 0; i + 1 < route.num_stops; ++i) {
+                int32_t seconds = timetable.arrival(p, t, i + 1) - timetable.departure(p, t, i);
+                fastest = std::max(fastest, hop_meters[i] / std::max(seconds, 1));
             }
         }
     }
+    for (uint32_t s = 0; s < stops.size(); ++s) {
+        for (const Footpath* walk = footpaths.outBegin(s); walk != footpaths.outEnd(s); ++walk) {
+            fastest = std::max(fastest, meters(s, walk->stop) / std::max(walk->duration_seconds, 1));
+        }
+    }
+    return fastest;
+}
+
+// The Pareto front of a profile as it is built from the latest departure backwards. Like
+// ParetoBag, a journey is kept unless one with no more trips arrives no later; all journeys
+// offered before it leave at least as late. A pure walk can start any time: it is kept once,
+// and drops every journey that is no faster.
+struct ProfileFront {
+    Time best_at_end[MAX_TRIPS + 1];
+    bool reached_end[MAX_TRIPS + 1] = {};
+    int32_t walk_seconds = -1;
 
-    const Stop& end_stop_details = stops.at(end_stop_id);
-    for (const auto& profile_pair : temp_final_profiles) {
-        int reached_stop_id = profile_pair.first;
-        if (reached_stop_id == end_stop_id) continue; // No need to walk from destination to itself
+    bool add(const Journey& journey) {
+        const int trips = journey.trips();
+        const int32_t duration = journey.arrival_time.toSeconds() - journey.departure_time.toSeconds();
+        if (trips == 0) {
+            if (walk_seconds >= 0) return false;
+            walk_seconds = duration;
+            return true;
+        }
+        if (walk_seconds >= 0 && duration >= walk_seconds) return false;
+        for (int k = 1; k <= trips; ++k) {
+            if (reached_end[k] && best_at_end[k] <= journey.arrival_time) return false;
+        }
+        best_at_end[trips] = journey.arrival_time;
+        reached_end[trips] = true;
+        return true;
+    }
+};
+
+// Range RAPTOR over departures sorted latest first. Labels are kept between runs: whatever a
+// later departure reaches is still reachable when leaving earlier, so each run only explores
+// what it improves.
+static void runRangeSlice(uint32_t start_stop_idx, uint32_t end_stop_idx, const int32_t* departures, size_t count,
+                          size_t num_stops, const FootpathGraph& footpaths, const Timetable& timetable,
+                          std::vector<ProfileJourney>& profile) {
+    RaptorWorkspace& ws = threadWorkspace();
+    ws.startQuery(num_stops, timetable.patterns.size());
+    ProfileFront front;
+    for (size_t d = 0; d < count; ++d) {
+        runRounds(start_stop_idx, Time(departures[d]), footpaths, timetable, ws);
+        for (int k = 0; k <= MAX_TRIPS; ++k) {
+            Journey candidate;
+            if (!arrivalAt(end_stop_idx, k, footpaths, ws.rounds, candidate) || !front.add(candidate)) continue;
+            ProfileJourney found;
+            found.journey = candidate;
+            collectPredecessors(start_stop_idx, candidate, ws.rounds, found.predecessors);
+            profile.push_back(std::move(found));
+        }
+    }
+}
 
-        const Stop& reached_stop_details = stops.at(reached_stop_id);
-        double distance = haversine(reached_stop_details.lat, reached_stop_details.lon, end_stop_details.lat, end_stop_details.lon);
-        if (distance <= MAX_WALK_DISTANCE_METERS) {
-            int walk_duration_seconds = static_cast<int>(distance / WALKING_SPEED_MPS);
-            for (const auto& journey : profile_pair.second) {
-                 Journey final_walk = { Time::fromSeconds(journey.arrival_time.toSeconds() + walk_duration_seconds), journey.trips, journey.departure_time, reached_stop_id, "Walk" };
-                merge(final_profiles[end_stop_id], final_walk);
+void runRangeRaptor(uint32_t start_stop_idx, uint32_t end_stop_idx, const Time& window_start, const Time& window_end,
+                    const StopTable& stops,
+                    const FootpathGraph& footpaths,
+                    const Timetable& timetable,
+                    std::vector<ProfileJourney>& profile) {
+    // Departures worth trying: the moments we must leave the origin to catch some trip at the
+    // origin or at a stop within walking distance of it
+    std::vector<int32_t> departures;
+    auto collect = [&](uint32_t stop_idx, int32_t walk_seconds) {
+        for (const PatternStop* ps = timetable.patternsAtBegin(stop_idx); ps != timetable.patternsAtEnd(stop_idx); ++ps) {
+            const RoutePattern& route = timetable.patterns[ps->pattern];
+            if (ps->position + 1 == route.num_stops) continue; // nothing to ride to from the last stop
+            for (uint32_t t = 0; t < route.num_trips; ++t) {
+                int32_t leave = timetable.departure(ps->pattern, t, ps->position) - walk_seconds;
+                if (leave >= window_start.toSeconds() && leave <= window_end.toSeconds()) departures.push_back(leave);
             }
         }
+    };
+    collect(start_stop_idx, 0);
+    for (const Footpath* walk = footpaths.outBegin(start_stop_idx); walk != footpaths.outEnd(start_stop_idx); ++walk) {
+        collect(walk->stop, walk->duration_seconds);
     }
+    if (departures.empty()) departures.push_back(window_start.toSeconds()); // still report a walk
+    std::sort(departures.begin(), departures.end(), std::greater<int32_t>());
+    departures.erase(std::unique(departures.begin(), departures.end()), departures.end());
+
+    // Wide windows are split into slices of consecutive departures, one per worker thread, each
+    // searched with that thread's own workspace. A slice gives up the labels of the later
+    // slices, so short windows with few departures stay on one thread.
+    const size_t min_slice = 16;
+    const size_t num_slices = std::max<size_t>(1, std::min<size_t>(workerCount(), departures.size() / min_slice));
+    const size_t slice_size = (departures.size() + num_slices - 1) / num_slices;
+    std::vector<std::vector<ProfileJourney>> slices(num_slices);
+    parallelFor(departures.size(), slice_size, [&](size_t begin, size_t end) {
+        runRangeSlice(start_stop_idx, end_stop_idx, departures.data() + begin, end - begin, stops.size(),
+                      footpaths, timetable, slices[begin / slice_size]);
+    });
 
-    for (const auto& pair : temp_final_profiles) {
-        for (const auto& journey : pair.second) {
-            merge(final_profiles[pair.first], journey);
+    // Each slice front is only Pareto-optimal within its slice: replay them latest slice first
+    // through one front, which drops whatever a later departure beats
+    ProfileFront front;
+    for (auto& slice : slices) {
+        for (auto& found : slice) {
+            if (num_slices == 1 || front.add(found.journey)) profile.push_back(std::move(found));
         }
     }
 
-    for(const auto& profile_pair : final_profiles) {
-        for(const auto& journey : profile_pair.second) {
-            predecessors[profile_pair.first][journey.trips] = journey;
+    // Earliest departure first, as the journeys appear in a timetable
+    std::sort(profile.begin(), profile.end(), [](const ProfileJourney& a, const ProfileJourney& b) {
+        if (a.journey.departure_time != b.journey.departure_time) return a.journey.departure_time < b.journey.departure_time;
+        return a.journey.trips() < b.journey.trips();
+    });
+}
+
+void runTravelTimeMatrix(const uint32_t* origins, size_t num_origins, const std::vector<uint32_t>& targets,
+                         const Time& departure,
+                         const StopTable& stops,
+                         const FootpathGraph& footpaths,
+                         const Timetable& timetable,
+                         std::vector<int32_t>& arrivals) {
+    arrivals.assign(num_origins * targets.size(), UNREACHABLE);
+    parallelFor(num_origins, 1, [&](size_t begin, size_t end) {
+        RaptorWorkspace& ws = threadWorkspace();
+        for (size_t o = begin; o < end; ++o) {
+            ws.startQuery(stops.size(), timetable.patterns.size());
+            runRounds(origins[o], departure, footpaths, timetable, ws);
+
+            // Every target is read off the same labels
+            int32_t* row = &arrivals[o * targets.size()];
+            for (size_t t = 0; t < targets.size(); ++t) {
+                for (int k = 0; k <= MAX_TRIPS; ++k) {
+                    Journey journey;
+                    if (!arrivalAt(targets[t], k, footpaths, ws.rounds, journey)) continue;
+                    if (row[t] == UNREACHABLE || journey.arrival_time.toSeconds() < row[t]) row[t] = journey.arrival_time.toSeconds();
+                }
+            }
+        }
+    });
+}
+
+void runIsochrone(uint32_t start_stop_idx, const Time& departure, const Time& deadline,
+                  const StopTable& stops,
+                  const FootpathGraph& footpaths,
+                  const Timetable& timetable,
+                  std::vector<std::pair<uint32_t, Time>>& reached) {
+    RaptorWorkspace& ws = threadWorkspace();
+    ws.startQuery(stops.size(), timetable.patterns.size());
+    runRounds(start_stop_idx, departure, footpaths, timetable, ws, deadline);
+
+    // Labels are per round; keep the earliest one of each stop. Rounds are visited in order,
+    // so a stop's first entry is its round-0 label or the first round that reached it.
+    std::vector<uint32_t>& first_entry = ws.scratch_stops;
+    first_entry.assign(stops.size(), UINT32_MAX);
+    for (int k = 0; k <= MAX_TRIPS; ++k) {
+        for (uint32_t stop_idx : ws.rounds.touched[k]) {
+            Time arrival = ws.rounds.get(k, stop_idx).arrival_time;
+            if (first_entry[stop_idx] == UINT32_MAX) {
+                first_entry[stop_idx] = static_cast<uint32_t>(reached.size());
+                reached.push_back({stop_idx, arrival});
+            } else if (arrival < reached[first_entry[stop_idx]].second) {
+                reached[first_entry[stop_idx]].second = arrival;
+            }
         }
     }
 }
@@ -5,23 +5,81 @@
 #include <vector>
 #include <string>
 #include "DataTypes.h"
-#include "robin_hood.h"
+#include "Timetable.h"
+#include "Footpaths.h"
+#include "Network.h"
+// Walking model shared by the router and the stop lookup endpoints
+const double WALKING_SPEED_MPS = 1.4;
+const double MAX_WALK_DISTANCE_METERS = 1500;
+
+// Upper bound on the number of trips in a journey, i.e. the number of RAPTOR rounds
+const int MAX_TRIPS = 5;
+
+// A journey has at most one walk before and after each trip
+const int MAX_LEGS = 2 * MAX_TRIPS + 3;
+
 // Struct to hold a single step of a reconstructed path
 struct PathStep {
-    int stop_id;
+    int stop_id; // GTFS stop_id
     std::string stop_name;
     Time arrival_time;
     std::string method;
 };
 
+// One journey to the destination, with the labels reconstructPath needs to expand it
+struct ProfileJourney {
+    Journey journey; // as it reaches the destination
+    JourneyLegs predecessors;
+};
+
 // Main algorithm function declaration
-void runMultiCriteriaRaptor(int start_stop_id, int end_stop_id, const Time& start_time,
-                            const robin_hood::unordered_map<int, Stop>& stops,
-                            const robin_hood::unordered_map<int, std::vector<Transfer>>& transfers_map,
-                            const robin_hood::unordered_map<std::string, std::vector<StopTime>>& trips_map,
-                            const robin_hood::unordered_map<int, std::vector<std::string>>& routes_serving_stop,
-                            const robin_hood::unordered_map<std::string, robin_hood::unordered_map<int, int>>& trip_stop_indices,
-                            robin_hood::unordered_map<int, std::vector<Journey>>& final_profiles,
-                            robin_hood::unordered_map<int, robin_hood::unordered_map<int, Journey>>& predecessors
-                           );
+// Stop arguments are dense indices (see Network.h). Appends the journeys that are Pareto-optimal
+// in arrival time and number of trips. The search runs in a per-thread workspace sized to the
+// network, so once `journeys` has grown to size a query allocates nothing.
+// A positive lower_bound_speed_mps (see maxTravelSpeed) also prunes labels that cannot beat
+// the destination even when covering the straight-line distance to it at that speed, and
+// `landmarks` those that cannot even at the landmark lower bound (see Landmarks.h).
+void runMultiCriteriaRaptor(uint32_t start_stop_idx, uint32_t end_stop_idx, const Time& start_time,
+                            const StopTable& stops,
+                            const FootpathGraph& footpaths,
+                            const Timetable& timetable,
+                            std::vector<ProfileJourney>& journeys,
+                            double lower_bound_speed_mps = 0,
+                            const LandmarkTable* landmarks = nullptr);
+
+// The fastest anything moves between two stops, in m/s: a trip between consecutive stops or a
+// footpath, whichever is faster (a hop taking no time counts as one second). Straight-line
+// distance at this speed does not overestimate travel time, so it is safe for pruning.
+double maxTravelSpeed(const StopTable& stops, const FootpathGraph& footpaths, const Timetable& timetable);
+
+// Range RAPTOR: all journeys from start to end leaving within [window_start, window_end] that
+// no other journey beats by leaving later, arriving earlier and using no more trips. Runs one
+// search per distinct departure, latest first, reusing the labels of the previous runs. Wide
+// windows are split across worker threads. The profile is sorted by departure time.
+void runRangeRaptor(uint32_t start_stop_idx, uint32_t end_stop_idx, const Time& window_start, const Time& window_end,
+                    const StopTable& stops,
+                    const FootpathGraph& footpaths,
+                    const Timetable& timetable,
+                    std::vector<ProfileJourney>& profile);
+
+// Marks a target that no journey reaches within MAX_TRIPS trips in a travel-time matrix
+const int32_t UNREACHABLE = -1;
+
+// Travel-time matrix: one RAPTOR search per origin, leaving at `departure`, spread over the
+// worker threads. Fills `arrivals` row by row (num_origins x targets.size()) with the earliest
+// arrival at each target in seconds after midnight, final walk included, or UNREACHABLE.
+void runTravelTimeMatrix(const uint32_t* origins, size_t num_origins, const std::vector<uint32_t>& targets,
+                         const Time& departure,
+                         const StopTable& stops,
+                         const FootpathGraph& footpaths,
+                         const Timetable& timetable,
+                         std::vector<int32_t>& arrivals);
+
+// Isochrone: the earliest arrival at every stop reached from start, leaving at `departure`, no
+// later than `deadline`. Labels past the deadline are never created; no paths are kept.
+void runIsochrone(uint32_t start_stop_idx, const Time& departure, const Time& deadline,
+                  const StopTable& stops,
+                  const FootpathGraph& footpaths,
+                  const Timetable& timetable,
+                  std::vector<std::pair<uint32_t, Time>>& reached);
 #endif // RAPTOR_H_INCLUDED
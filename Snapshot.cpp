@@ -0,0 +1,226 @@
+#include "Snapshot.h"
+#include <vector>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = {'T', 'P', 'S', 'N', 'A', 'P', 0, 0};
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+const size_t ARRAY_ALIGNMENT = 64;
+
+struct GridScalars {
+    double min_lat, min_lon;
+    double cell_lat_deg, cell_lon_deg;
+    uint32_t rows, cols;
+};
+
+// The GTFS files buildNetwork reads. A snapshot records their size and modification time and
+// is only used while they still match.
+const char* const SOURCE_FILES[] = {"stops.txt", "stop_times.txt", "transfers.txt"};
+const size_t NUM_SOURCE_FILES = sizeof(SOURCE_FILES) / sizeof(SOURCE_FILES[0]);
+
+struct SourceStamp {
+    uint64_t size;     // both 0 when the (optional) file is missing
+    int64_t modified;
+};
+
+// The checksum covers everything from num_arrays to the end of the file
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t file_size;
+    uint64_t checksum;
+    uint32_t num_arrays;
+    uint32_t reserved;
+    GridScalars grid;
+    SourceStamp sources[NUM_SOURCE_FILES];
+};
+
+struct ArrayEntry {
+    uint64_t offset; // from the start of the file
+    uint64_t count;
+    uint32_t element_size;
+    uint32_t reserved;
+};
+
+const size_t CHECKED_FROM = offsetof(SnapshotHeader, num_arrays);
+
+// Every flat array of a Network, in file order
+template <typename NetworkT, typename Visitor>
+void forEachArray(NetworkT& n, Visitor&& visit) {
+    visit(n.stops.ids);
+    visit(n.stops.lats);
+    visit(n.stops.lons);
+    visit(n.stops.names.offsets);
+    visit(n.stops.names.chars);
+    visit(n.stops.by_id);
+    visit(n.trip_ids.offsets);
+    visit(n.trip_ids.chars);
+    visit(n.timetable.patterns);
+    visit(n.timetable.pattern_stops);
+    visit(n.timetable.pattern_trips);
+    visit(n.timetable.arrivals);
+    visit(n.timetable.departures);
+    visit(n.timetable.stop_pattern_offsets);
+    visit(n.timetable.stop_patterns);
+    visit(n.stop_grid.cell_offsets);
+    visit(n.stop_grid.cell_stops);
+    visit(n.stop_grid.cell_lats);
+    visit(n.stop_grid.cell_lons);
+    visit(n.footpaths.out_offsets);
+    visit(n.footpaths.out_edges);
+    visit(n.footpaths.in_offsets);
+    visit(n.footpaths.in_edges);
+    visit(n.connections.connections);
+    visit(n.trip_transfers.offsets);
+    visit(n.trip_transfers.targets);
+    visit(n.landmarks.stops);
+    visit(n.landmarks.to_landmark);
+    visit(n.landmarks.from_landmark);
+}
+
+uint32_t countArrays() {
+    uint32_t count = 0;
+    Network network;
+    forEachArray(network, [&](const auto&) { ++count; });
+    return count;
+}
+
+// Word-at-a-time multiply/xorshift hash; catches truncated and corrupted files, not tampering
+uint64_t checksum(const char* data, size_t size) {
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h = (h ^ word) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 29;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + i, size - i);
+    h = (h ^ tail) * 0xC4CEB9FE1A85EC53ull;
+    return h ^ (h >> 32);
+}
+
+void stampSources(const std::string& data_dir, SourceStamp* sources) {
+    for (size_t i = 0; i < NUM_SOURCE_FILES; ++i) {
+        if (!fileStamp(joinPath(data_dir, SOURCE_FILES[i]), sources[i].size, sources[i].modified)) sources[i] = {0, 0};
+    }
+}
+
+size_t alignUp(size_t offset) { return (offset + ARRAY_ALIGNMENT - 1) / ARRAY_ALIGNMENT * ARRAY_ALIGNMENT; }
+
+} // namespace
+
+bool writeSnapshot(const Network& network, const std::string& path, const std::string& data_dir) {
+    const uint32_t num_arrays = countArrays();
+
+    // Lay out the whole file in memory first; offsets have to be known before hashing
+    size_t offset = alignUp(sizeof(SnapshotHeader) + num_arrays * sizeof(ArrayEntry));
+    std::vector<ArrayEntry> entries;
+    forEachArray(network, [&](const auto& array) {
+        typedef typename std::decay<decltype(array[0])>::type T;
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot arrays must be plain data");
+        entries.push_back({offset, array.size(), static_cast<uint32_t>(sizeof(T)), 0});
+        offset = alignUp(offset + array.size() * sizeof(T));
+    });
+
+    std::vector<char> image(offset, 0);
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.file_size = image.size();
+    header.num_arrays = num_arrays;
+    header.grid = {network.stop_grid.min_lat, network.stop_grid.min_lon,
+                   network.stop_grid.cell_lat_deg, network.stop_grid.cell_lon_deg,
+                   network.stop_grid.rows, network.stop_grid.cols};
+    stampSources(data_dir, header.sources);
+
+    size_t index = 0;
+    forEachArray(network, [&](const auto& array) {
+        if (!array.empty()) std::memcpy(image.data() + entries[index].offset, array.data(), array.size() * entries[index].element_size);
+        ++index;
+    });
+    std::memcpy(image.data() + sizeof(SnapshotHeader), entries.data(), entries.size() * sizeof(ArrayEntry));
+    std::memcpy(image.data(), &header, sizeof(header));
+    header.checksum = checksum(image.data() + CHECKED_FROM, image.size() - CHECKED_FROM);
+    std::memcpy(image.data(), &header, sizeof(header));
+
+    const std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out.write(image.data(), image.size())) {
+            std::cerr << "Cannot write " << temp_path << std::endl;
+            return false;
+        }
+    }
+    std::remove(path.c_str()); // rename() does not replace an existing file on Windows
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Cannot rename " << temp_path << " to " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool openSnapshot(const std::string& path, const std::string& data_dir, MappedFile& file, Network& network) {
+    if (!file.open(path, MapAccess::Random)) return false;
+
+    auto reject = [&](const char* reason) {
+        std::cerr << "Ignoring snapshot " << path << ": " << reason << std::endl;
+        file.close();
+        return false;
+    };
+
+    const char* base = file.data().data();
+    const size_t size = file.size();
+    SnapshotHeader header;
+    if (size < sizeof(header)) return reject("file is truncated");
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) return reject("not a timetable snapshot");
+    if (header.version != SNAPSHOT_VERSION) return reject("written by a different version");
+    if (header.byte_order != BYTE_ORDER_MARK) return reject("written on a machine with another byte order");
+    if (header.file_size != size) return reject("file is truncated");
+    if (header.num_arrays != countArrays()) return reject("unexpected array count");
+    if (size < sizeof(header) + header.num_arrays * sizeof(ArrayEntry)) return reject("file is truncated");
+    if (checksum(base + CHECKED_FROM, size - CHECKED_FROM) != header.checksum) return reject("checksum mismatch");
+    SourceStamp sources[NUM_SOURCE_FILES];
+    stampSources(data_dir, sources);
+    if (std::memcmp(sources, header.sources, sizeof(sources)) != 0) return reject("the GTFS files changed since it was compiled");
+
+    const ArrayEntry* entries = reinterpret_cast<const ArrayEntry*>(base + sizeof(SnapshotHeader));
+    for (uint32_t i = 0; i < header.num_arrays; ++i) {
+        if (entries[i].offset % ARRAY_ALIGNMENT != 0 || entries[i].offset > size ||
+            entries[i].count > (size - entries[i].offset) / (entries[i].element_size ? entries[i].element_size : 1)) {
+            return reject("array out of bounds");
+        }
+    }
+    bool layout_matches = true;
+    size_t index = 0;
+    forEachArray(network, [&](auto& array) {
+        typedef typename std::decay<decltype(array[0])>::type T;
+        if (entries[index++].element_size != sizeof(T)) layout_matches = false;
+    });
+    if (!layout_matches) return reject("element layout differs from this build");
+
+    index = 0;
+    forEachArray(network, [&](auto& array) {
+        typedef typename std::decay<decltype(array[0])>::type T;
+        const ArrayEntry& entry = entries[index++];
+        array = std::decay<decltype(array)>::type::view(reinterpret_cast<const T*>(base + entry.offset), entry.count);
+    });
+    network.stop_grid.min_lat = header.grid.min_lat;
+    network.stop_grid.min_lon = header.grid.min_lon;
+    network.stop_grid.cell_lat_deg = header.grid.cell_lat_deg;
+    network.stop_grid.cell_lon_deg = header.grid.cell_lon_deg;
+    network.stop_grid.rows = header.grid.rows;
+    network.stop_grid.cols = header.grid.cols;
+    return true;
+}
@@ -0,0 +1,28 @@
+#ifndef SNAPSHOT_H_INCLUDED
+#define SNAPSHOT_H_INCLUDED
+
+#include <string>
+#include <cstdint>
+#include "Network.h"
+#include "MappedFile.h"
+
+// Binary image of a preprocessed Network. Every array is stored 64-byte aligned in the
+// layout the router reads, so a mapped snapshot is used in place: opening one performs no
+// parsing and no allocation, only a checksum pass over the file.
+//
+// Bump SNAPSHOT_VERSION whenever the layout of any stored array changes.
+const char SNAPSHOT_FILE_NAME[] = "timetable.bin";
+const uint32_t SNAPSHOT_VERSION = 5;
+
+// Writes the network built from the GTFS files in data_dir to `path` (through a temporary
+// file, so readers never see a partial one). The size and modification time of each GTFS file
+// are recorded with it.
+bool writeSnapshot(const Network& network, const std::string& path, const std::string& data_dir);
+
+// Maps `path` into `file` and points the arrays of `network` into it. Returns false when the
+// file is missing, or (with a message) when it was written by another version, is corrupt, or
+// the GTFS files in data_dir have changed since it was written.
+// `file` must stay open for as long as `network` is used.
+bool openSnapshot(const std::string& path, const std::string& data_dir, MappedFile& file, Network& network);
+
+#endif // SNAPSHOT_H_INCLUDED
@@ -0,0 +1,78 @@
+#include "StopGrid.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+std::vector<std::pair<uint32_t, double>> StopGrid::nearest(double lat, double lon, size_t count, double max_radius_m) const {
+    std::vector<std::pair<uint32_t, double>> found;
+    forEachWithin(lat, lon, max_radius_m, [&](uint32_t stop_idx, double distance) { found.push_back({stop_idx, distance}); });
+    auto by_distance = [](const std::pair<uint32_t, double>& a, const std::pair<uint32_t, double>& b) {
+        return a.second < b.second || (a.second == b.second && a.first < b.first);
+    };
+    if (found.size() > count) {
+        std::partial_sort(found.begin(), found.begin() + count, found.end(), by_distance);
+        found.resize(count);
+    } else {
+        std::sort(found.begin(), found.end(), by_distance);
+    }
+    return found;
+}
+
+StopGrid buildStopGrid(const std::vector<Stop>& stops, double cell_size_m) {
+    StopGrid grid;
+    if (stops.empty()) return grid;
+
+    double min_lat = stops[0].lat, max_lat = stops[0].lat;
+    double min_lon = stops[0].lon, max_lon = stops[0].lon;
+    for (const auto& stop : stops) {
+        min_lat = std::min(min_lat, stop.lat); max_lat = std::max(max_lat, stop.lat);
+        min_lon = std::min(min_lon, stop.lon); max_lon = std::max(max_lon, stop.lon);
+    }
+
+    // Cells are square at the middle latitude of the network
+    const double meters_per_degree = 6371000.0 * M_PI / 180.0;
+    double mid_lat = std::min(89.0, std::fabs((min_lat + max_lat) / 2.0));
+    grid.min_lat = min_lat;
+    grid.min_lon = min_lon;
+    grid.cell_lat_deg = cell_size_m / meters_per_degree;
+    grid.cell_lon_deg = cell_size_m / (meters_per_degree * std::cos(mid_lat * M_PI / 180.0));
+
+    // A stray stop far away (e.g. missing coordinates) must not blow up the cell count
+    const double max_cells = 4.0 * 1024 * 1024;
+    double rows = std::floor((max_lat - min_lat) / grid.cell_lat_deg) + 1;
+    double cols = std::floor((max_lon - min_lon) / grid.cell_lon_deg) + 1;
+    if (rows * cols > max_cells) {
+        double scale = std::sqrt(rows * cols / max_cells);
+        grid.cell_lat_deg *= scale;
+        grid.cell_lon_deg *= scale;
+        rows = std::floor((max_lat - min_lat) / grid.cell_lat_deg) + 1;
+        cols = std::floor((max_lon - min_lon) / grid.cell_lon_deg) + 1;
+    }
+    grid.rows = static_cast<uint32_t>(rows);
+    grid.cols = static_cast<uint32_t>(cols);
+
+    auto cellOf = [&](const Stop& stop) {
+        uint32_t r = std::min(grid.rows - 1, static_cast<uint32_t>((stop.lat - grid.min_lat) / grid.cell_lat_deg));
+        uint32_t c = std::min(grid.cols - 1, static_cast<uint32_t>((stop.lon - grid.min_lon) / grid.cell_lon_deg));
+        return r * grid.cols + c;
+    };
+
+    std::vector<uint32_t> cell_offsets(static_cast<size_t>(grid.rows) * grid.cols + 1, 0);
+    for (const auto& stop : stops) cell_offsets[cellOf(stop) + 1]++;
+    for (size_t c = 0; c + 1 < cell_offsets.size(); ++c) cell_offsets[c + 1] += cell_offsets[c];
+
+    std::vector<uint32_t> cell_stops(stops.size());
+    std::vector<double> cell_lats(stops.size()), cell_lons(stops.size());
+    std::vector<uint32_t> fill(cell_offsets.begin(), cell_offsets.end() - 1);
+    for (uint32_t s = 0; s < stops.size(); ++s) {
+        uint32_t slot = fill[cellOf(stops[s])]++;
+        cell_stops[slot] = s;
+        cell_lats[slot] = stops[s].lat;
+        cell_lons[slot] = stops[s].lon;
+    }
+    grid.cell_offsets = std::move(cell_offsets);
+    grid.cell_stops = std::move(cell_stops);
+    grid.cell_lats = std::move(cell_lats);
+    grid.cell_lons = std::move(cell_lons);
+    return grid;
+}
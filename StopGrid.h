@@ -0,0 +1,54 @@
+#ifndef STOPGRID_H_INCLUDED
+#define STOPGRID_H_INCLUDED
+
+#include "DataTypes.h" // first, so M_PI is defined before <cmath> is pulled in
+#include "FlatArray.h"
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+// Uniform lat/lon grid over the stops, so that finding every stop within walking distance
+// of a point only looks at the few cells overlapping the circle instead of all stops.
+struct StopGrid {
+    double min_lat = 0.0, min_lon = 0.0;
+    double cell_lat_deg = 1.0, cell_lon_deg = 1.0;
+    uint32_t rows = 0, cols = 0;
+    FlatArray<uint32_t> cell_offsets; // stops of each cell in CSR form, size rows * cols + 1
+    FlatArray<uint32_t> cell_stops;   // stop indices, grouped by cell
+    FlatArray<double> cell_lats;      // coordinates copied alongside cell_stops
+    FlatArray<double> cell_lons;
+
+    // Calls visit(stop_idx, distance_meters) for every stop within radius_m of (lat, lon)
+    template <typename Visitor>
+    void forEachWithin(double lat, double lon, double radius_m, Visitor&& visit) const {
+        if (rows == 0) return;
+        const double meters_per_degree = 6371000.0 * M_PI / 180.0;
+        // Pad the search window slightly so the flat-earth cell bounds never cut off a stop
+        double dlat = radius_m * 1.01 / meters_per_degree;
+        double widest = std::min(89.0, std::max(std::fabs(lat - dlat), std::fabs(lat + dlat)));
+        double dlon = radius_m * 1.01 / (meters_per_degree * std::cos(widest * M_PI / 180.0));
+
+        int r0 = std::max(0, static_cast<int>(std::floor((lat - dlat - min_lat) / cell_lat_deg)));
+        int r1 = std::min(static_cast<int>(rows) - 1, static_cast<int>(std::floor((lat + dlat - min_lat) / cell_lat_deg)));
+        int c0 = std::max(0, static_cast<int>(std::floor((lon - dlon - min_lon) / cell_lon_deg)));
+        int c1 = std::min(static_cast<int>(cols) - 1, static_cast<int>(std::floor((lon + dlon - min_lon) / cell_lon_deg)));
+        for (int r = r0; r <= r1; ++r) {
+            for (int c = c0; c <= c1; ++c) {
+                uint32_t cell = static_cast<uint32_t>(r) * cols + static_cast<uint32_t>(c);
+                for (uint32_t i = cell_offsets[cell]; i < cell_offsets[cell + 1]; ++i) {
+                    double distance = haversine(lat, lon, cell_lats[i], cell_lons[i]);
+                    if (distance <= radius_m) visit(cell_stops[i], distance);
+                }
+            }
+        }
+    }
+
+    // Up to `count` stops within max_radius_m of (lat, lon), closest first
+    std::vector<std::pair<uint32_t, double>> nearest(double lat, double lon, size_t count, double max_radius_m) const;
+};
+
+// Buckets the stops into square cells of roughly cell_size_m meters
+StopGrid buildStopGrid(const std::vector<Stop>& stops, double cell_size_m);
+
+#endif // STOPGRID_H_INCLUDED
@@ -0,0 +1,134 @@
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "Timetable.h"
+#include "Parallel.h"
+
+uint32_t Timetable::earliestTrip(uint32_t p, uint32_t position, int32_t time, uint32_t limit) const {
+    const RoutePattern& route = patterns[p];
+    uint32_t lo = 0, hi = limit;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (departures[route.first_event + mid * route.num_stops + position] < time) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+uint32_t Timetable::patternOfTrip(uint32_t trip_slot) const {
+    auto it = std::upper_bound(patterns.begin(), patterns.end(), trip_slot,
+        [](uint32_t slot, const RoutePattern& route) { return slot < route.first_trip; });
+    return static_cast<uint32_t>(it - patterns.begin()) - 1;
+}
+
+uint32_t Timetable::patternOfEvent(uint32_t event) const {
+    auto it = std::upper_bound(patterns.begin(), patterns.end(), event,
+        [](uint32_t e, const RoutePattern& route) { return e < route.first_event; });
+    return static_cast<uint32_t>(it - patterns.begin()) - 1;
+}
+
+Timetable buildTimetable(const TripStore& trips, size_t num_stops) {
+    // Group trips by their exact stop sequence
+    std::map<std::vector<uint32_t>, std::vector<uint32_t>> trips_by_sequence;
+    for (uint32_t t = 0; t < trips.size(); ++t) {
+        if (trips.length(t) == 0) continue;
+        const uint32_t* first = trips.stops.data() + trips.begin(t);
+        trips_by_sequence[std::vector<uint32_t>(first, first + trips.length(t))].push_back(t);
+    }
+
+    // Split every group into FIFO patterns: sort by departure, then put each trip into the
+    // first pattern whose latest trip it does not overtake.
+    std::vector<std::pair<const std::vector<uint32_t>*, std::vector<uint32_t>>> pattern_trip_lists;
+    for (auto& group : trips_by_sequence) {
+        auto& trip_indices = group.second;
+        std::sort(trip_indices.begin(), trip_indices.end(), [&](uint32_t a, uint32_t b) {
+            int32_t da = trips.departures[trips.begin(a)];
+            int32_t db = trips.departures[trips.begin(b)];
+            if (da < db) return true;
+            if (db < da) return false;
+            return a < b;
+        });
+
+        size_t first_pattern = pattern_trip_lists.size();
+        for (uint32_t trip_idx : trip_indices) {
+            const uint32_t current = trips.begin(trip_idx), length = trips.length(trip_idx);
+            size_t target = pattern_trip_lists.size();
+            for (size_t p = first_pattern; p < pattern_trip_lists.size(); ++p) {
+                const uint32_t last = trips.begin(pattern_trip_lists[p].second.back());
+                bool overtakes = false;
+                for (uint32_t i = 0; i < length && !overtakes; ++i) {
+                    overtakes = trips.departures[current + i] < trips.departures[last + i] ||
+                                trips.arrivals[current + i] < trips.arrivals[last + i];
+                }
+                if (!overtakes) { target = p; break; }
+            }
+            if (target == pattern_trip_lists.size()) {
+                pattern_trip_lists.push_back({&group.first, {}});
+            }
+            pattern_trip_lists[target].second.push_back(trip_idx);
+        }
+    }
+
+    // Lay the patterns out flat
+    size_t total_events = 0;
+    for (const auto& entry : pattern_trip_lists) total_events += entry.first->size() * entry.second.size();
+    std::vector<RoutePattern> patterns;
+    std::vector<uint32_t> pattern_stops, pattern_trips;
+    std::vector<int32_t> arrivals, departures;
+    patterns.reserve(pattern_trip_lists.size());
+
+    uint32_t next_event = 0;
+    for (const auto& entry : pattern_trip_lists) {
+        const auto& sequence = *entry.first;
+        const auto& trip_indices = entry.second;
+        RoutePattern route;
+        route.first_stop = static_cast<uint32_t>(pattern_stops.size());
+        route.num_stops = static_cast<uint32_t>(sequence.size());
+        route.first_trip = static_cast<uint32_t>(pattern_trips.size());
+        route.num_trips = static_cast<uint32_t>(trip_indices.size());
+        route.first_event = next_event;
+        next_event += route.num_stops * route.num_trips;
+        patterns.push_back(route);
+
+        pattern_stops.insert(pattern_stops.end(), sequence.begin(), sequence.end());
+        pattern_trips.insert(pattern_trips.end(), trip_indices.begin(), trip_indices.end());
+    }
+
+    // Every pattern owns a disjoint slice of the event columns, so they are filled in parallel
+    arrivals.resize(total_events);
+    departures.resize(total_events);
+    parallelFor(patterns.size(), 64, [&](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; ++p) {
+            uint32_t event = patterns[p].first_event;
+            for (uint32_t trip_idx : pattern_trip_lists[p].second) {
+                for (uint32_t e = trips.begin(trip_idx); e < trips.offsets[trip_idx + 1]; ++e) {
+                    arrivals[event] = trips.arrivals[e];
+                    departures[event] = trips.departures[e];
+                    ++event;
+                }
+            }
+        }
+    });
+
+    // Index the patterns serving each stop
+    std::vector<uint32_t> stop_pattern_offsets(num_stops + 1, 0);
+    for (uint32_t s : pattern_stops) stop_pattern_offsets[s + 1]++;
+    for (size_t s = 0; s < num_stops; ++s) stop_pattern_offsets[s + 1] += stop_pattern_offsets[s];
+    std::vector<PatternStop> stop_patterns(pattern_stops.size());
+    std::vector<uint32_t> fill(stop_pattern_offsets.begin(), stop_pattern_offsets.end() - 1);
+    for (uint32_t p = 0; p < patterns.size(); ++p) {
+        for (uint32_t i = 0; i < patterns[p].num_stops; ++i) {
+            stop_patterns[fill[pattern_stops[patterns[p].first_stop + i]]++] = {p, i};
+        }
+    }
+
+    Timetable tt;
+    tt.patterns = std::move(patterns);
+    tt.pattern_stops = std::move(pattern_stops);
+    tt.pattern_trips = std::move(pattern_trips);
+    tt.arrivals = std::move(arrivals);
+    tt.departures = std::move(departures);
+    tt.stop_pattern_offsets = std::move(stop_pattern_offsets);
+    tt.stop_patterns = std::move(stop_patterns);
+    return tt;
+}
@@ -0,0 +1,72 @@
+#ifndef TIMETABLE_H_INCLUDED
+#define TIMETABLE_H_INCLUDED
+
+#include <vector>
+#include <cstdint>
+#include "DataTypes.h"
+#include "FlatArray.h"
+
+// Where a stop appears inside a route pattern (a pattern may visit a stop twice).
+struct PatternStop { uint32_t pattern; uint32_t position; };
+
+// A route pattern groups trips that visit exactly the same stop sequence.
+// Trips are kept sorted by departure and never overtake each other, so the
+// earliest catchable trip at any position can be found with a binary search.
+struct RoutePattern {
+    uint32_t first_stop;  // into Timetable::pattern_stops
+    uint32_t num_stops;
+    uint32_t first_trip;  // into Timetable::pattern_trips
+    uint32_t num_trips;
+    uint32_t first_event; // into Timetable::arrivals / departures
+};
+
+// Stop events of every trip as loaded from stop_times.txt, in compressed sparse row form:
+// trip t owns [offsets[t], offsets[t + 1]), ordered by stop_sequence. Only used while building.
+struct TripStore {
+    std::vector<uint32_t> offsets; // size num_trips + 1
+    std::vector<uint32_t> stops;
+    std::vector<int32_t> arrivals;
+    std::vector<int32_t> departures;
+
+    size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    uint32_t begin(uint32_t t) const { return offsets[t]; }
+    uint32_t length(uint32_t t) const { return offsets[t + 1] - offsets[t]; }
+};
+
+// Flat struct-of-arrays timetable. The stop event of (pattern, trip, position) lives at
+// first_event + trip * num_stops + position, so scanning one trip along its route walks
+// the arrival and departure columns sequentially. Times are seconds since service-day start.
+struct Timetable {
+    FlatArray<RoutePattern> patterns;
+    FlatArray<uint32_t> pattern_stops; // stop index for each (pattern, position)
+    FlatArray<uint32_t> pattern_trips; // trip index for each (pattern, trip), for output only
+    FlatArray<int32_t> arrivals;
+    FlatArray<int32_t> departures;
+
+    // Patterns serving each stop, in compressed sparse row form
+    FlatArray<uint32_t> stop_pattern_offsets; // size num_stops + 1
+    FlatArray<PatternStop> stop_patterns;
+
+    uint32_t stop(uint32_t p, uint32_t position) const { return pattern_stops[patterns[p].first_stop + position]; }
+    uint32_t event(uint32_t p, uint32_t trip, uint32_t position) const { return patterns[p].first_event + trip * patterns[p].num_stops + position; }
+    int32_t arrival(uint32_t p, uint32_t trip, uint32_t position) const { return arrivals[event(p, trip, position)]; }
+    int32_t departure(uint32_t p, uint32_t trip, uint32_t position) const { return departures[event(p, trip, position)]; }
+
+    const PatternStop* patternsAtBegin(uint32_t stop_idx) const { return stop_patterns.data() + stop_pattern_offsets[stop_idx]; }
+    const PatternStop* patternsAtEnd(uint32_t stop_idx) const { return stop_patterns.data() + stop_pattern_offsets[stop_idx + 1]; }
+
+    // Pattern owning a trip slot (an index into pattern_trips)
+    uint32_t patternOfTrip(uint32_t trip_slot) const;
+
+    // Pattern owning a stop event (an index into arrivals / departures)
+    uint32_t patternOfEvent(uint32_t event) const;
+
+    // Index of the first trip of pattern p, among the first `limit`, departing `position` at or after `time`
+    uint32_t earliestTrip(uint32_t p, uint32_t position, int32_t time, uint32_t limit) const;
+};
+
+// Groups trips into route patterns and lays them out flat. A trip that would overtake its
+// predecessor gets its own pattern.
+Timetable buildTimetable(const TripStore& trips, size_t num_stops);
+
+#endif // TIMETABLE_H_INCLUDED
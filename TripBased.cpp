@@ -0,0 +1,224 @@
+#include "TripBased.h"
+#include <vector>
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+const uint32_t NO_SEGMENT = UINT32_MAX;
+
+// A stretch of one trip ridden in some round: boarded at `first`, and worth scanning up to
+// `last`, past which an earlier search already rode this trip or an earlier one of its pattern
+struct TripSegment {
+    uint32_t pattern;
+    uint32_t trip;   // within the pattern
+    uint32_t first;  // boarding position
+    uint32_t last;   // last arrival position to scan
+    uint32_t parent; // segment transferred from, NO_SEGMENT when boarded from the origin
+    uint32_t parent_alight; // position the parent segment was left at
+};
+
+// Per-query state, kept per thread and reused. Per-trip and per-stop entries carry the epoch
+// of the query that wrote them, so starting a query never clears anything.
+struct TripBasedWorkspace {
+    std::vector<uint32_t> reached;      // per trip slot: earliest boarding position so far
+    std::vector<uint32_t> reached_stamps;
+    std::vector<TripSegment> segments;  // all rounds, in order
+    std::vector<int32_t> walk_to_end;   // per stop: walk to the destination, if stamped
+    std::vector<uint32_t> walk_via;     // per stop: first stop of that walk
+    std::vector<uint32_t> walk_stamps;
+    std::vector<std::pair<uint32_t, int32_t>> next_to_end; // stops one footpath from the destination
+    std::vector<uint32_t> chain;        // segments of the journey being reconstructed
+    uint32_t epoch = 0;
+
+    void startQuery(size_t num_stops, size_t num_trips) {
+        if (reached.size() != num_trips || walk_to_end.size() != num_stops) {
+            reached.assign(num_trips, 0);
+            reached_stamps.assign(num_trips, 0);
+            walk_to_end.assign(num_stops, 0);
+            walk_via.assign(num_stops, 0);
+            walk_stamps.assign(num_stops, 0);
+            epoch = 0;
+        }
+        if (++epoch == 0) { // wrapped around: stale stamps could look current again
+            std::fill(reached_stamps.begin(), reached_stamps.end(), 0);
+            std::fill(walk_stamps.begin(), walk_stamps.end(), 0);
+            epoch = 1;
+        }
+        segments.clear();
+        next_to_end.clear();
+    }
+
+    bool canWalkToEnd(uint32_t stop) const { return walk_stamps[stop] == epoch; }
+    void setWalkToEnd(uint32_t stop, int32_t seconds, uint32_t via) {
+        if (canWalkToEnd(stop) && walk_to_end[stop] <= seconds) return;
+        walk_to_end[stop] = seconds;
+        walk_via[stop] = via;
+        walk_stamps[stop] = epoch;
+    }
+};
+
+TripBasedWorkspace& threadWorkspace() {
+    thread_local TripBasedWorkspace ws;
+    return ws;
+}
+
+// Walking time from one stop to another, both ends of a footpath the search used
+int32_t walkSeconds(const FootpathGraph& footpaths, uint32_t from, uint32_t to) {
+    for (const Footpath* walk = footpaths.outBegin(from); walk != footpaths.outEnd(from); ++walk) {
+        if (walk->stop == to) return walk->duration_seconds;
+    }
+    return 0;
+}
+
+} // namespace
+
+void runTripBasedQuery(uint32_t start_stop_idx, uint32_t end_stop_idx, const Time& start_time,
+                       const StopTable& stops,
+                       const FootpathGraph& footpaths,
+                       const Timetable& timetable,
+                       const TripTransferGraph& transfers,
+                       std::vector<ProfileJourney>& journeys) {
+    TripBasedWorkspace& ws = threadWorkspace();
+    ws.startQuery(stops.size(), timetable.pattern_trips.size());
+
+    // How to finish on foot: the destination is reached from a stop by at most two footpaths,
+    // the same walks other engines allow after the last trip
+    ws.setWalkToEnd(end_stop_idx, 0, end_stop_idx);
+    for (const Footpath* walk = footpaths.inBegin(end_stop_idx); walk != footpaths.inEnd(end_stop_idx); ++walk) {
+        ws.setWalkToEnd(walk->stop, walk->duration_seconds, end_stop_idx);
+        ws.next_to_end.push_back({walk->stop, walk->duration_seconds});
+    }
+    for (const auto& next : ws.next_to_end) {
+        for (const Footpath* walk = footpaths.inBegin(next.first); walk != footpaths.inEnd(next.first); ++walk) {
+            if (walk->stop != end_stop_idx) ws.setWalkToEnd(walk->stop, walk->duration_seconds + next.second, next.first);
+        }
+    }
+
+    // Queues the part of trip `trip` of pattern p from `position` on that nothing reached yet.
+    // Patterns are FIFO, so catching a trip there also covers every later trip of the pattern.
+    auto enqueue = [&](uint32_t p, uint32_t trip, uint32_t position, uint32_t parent, uint32_t parent_alight) {
+        const RoutePattern& route = timetable.patterns[p];
+        auto reachedAt = [&](uint32_t t) {
+            uint32_t slot = route.first_trip + t;
+            return ws.reached_stamps[slot] == ws.epoch ? ws.reached[slot] : route.num_stops;
+        };
+        const uint32_t previous = reachedAt(trip);
+        if (position >= previous) return;
+        ws.segments.push_back({p, trip, position, std::min(previous, route.num_stops - 1), parent, parent_alight});
+        for (uint32_t t = trip; t < route.num_trips && reachedAt(t) > position; ++t) {
+            ws.reached[route.first_trip + t] = position;
+            ws.reached_stamps[route.first_trip + t] = ws.epoch;
+        }
+    };
+
+    // Round 0 boards at the origin or a stop within walking distance of it
+    auto boardFrom = [&](uint32_t stop_idx, int32_t walk_seconds) {
+        for (const PatternStop* ps = timetable.patternsAtBegin(stop_idx); ps != timetable.patternsAtEnd(stop_idx); ++ps) {
+            const RoutePattern& route = timetable.patterns[ps->pattern];
+            if (ps->position + 1 == route.num_stops) continue;
+            uint32_t trip = timetable.earliestTrip(ps->pattern, ps->position, start_time.toSeconds() + walk_seconds, route.num_trips);
+            if (trip < route.num_trips) enqueue(ps->pattern, trip, ps->position, NO_SEGMENT, 0);
+        }
+    };
+    boardFrom(start_stop_idx, 0);
+    for (const Footpath* walk = footpaths.outBegin(start_stop_idx); walk != footpaths.outEnd(start_stop_idx); ++walk) {
+        boardFrom(walk->stop, walk->duration_seconds);
+    }
+
+    // Ends a journey at at_stop on foot, adding the labels of the walk
+    auto finishOnFoot = [&](ProfileJourney& found, uint32_t at_stop, const Time& at_time, int trips) {
+        if (at_stop == end_stop_idx) return;
+        const uint32_t via = ws.walk_via[at_stop];
+        uint32_t from = at_stop;
+        if (via != end_stop_idx) {
+            found.predecessors.set(via, Journey(at_time + walkSeconds(footpaths, at_stop, via), start_time, trips, static_cast<int32_t>(at_stop), LegKind::Walk));
+            from = via;
+        }
+        found.journey = Journey(at_time + ws.walk_to_end[at_stop], start_time, trips, static_cast<int32_t>(from), LegKind::Walk);
+    };
+
+    // A pure walk, if the destination is that close
+    const Journey start_label(start_time, start_time, 0, -1, LegKind::Start);
+    int32_t best_arrival = INT32_MAX;
+    if (ws.canWalkToEnd(start_stop_idx)) {
+        ProfileJourney walk_only;
+        walk_only.journey = start_label;
+        walk_only.predecessors.set(start_stop_idx, start_label);
+        finishOnFoot(walk_only, start_stop_idx, start_time, 0);
+        best_arrival = walk_only.journey.arrival_time.toSeconds();
+        journeys.push_back(std::move(walk_only));
+    }
+
+    // Turns the segment chain ending in `last_segment` into labels for reconstructPath
+    auto buildJourney = [&](uint32_t last_segment, uint32_t alight) {
+        std::vector<uint32_t>& chain = ws.chain;
+        chain.clear();
+        for (uint32_t s = last_segment; s != NO_SEGMENT; s = ws.segments[s].parent) chain.push_back(s);
+        std::reverse(chain.begin(), chain.end());
+
+        ProfileJourney found;
+        found.predecessors.set(start_stop_idx, start_label);
+        uint32_t at_stop = start_stop_idx;
+        Time at_time = start_time;
+        for (size_t n = 0; n < chain.size(); ++n) {
+            const TripSegment& seg = ws.segments[chain[n]];
+            const int trips = static_cast<int>(n);
+            uint32_t board_stop = timetable.stop(seg.pattern, seg.first);
+            if (board_stop != at_stop) {
+                at_time = at_time + walkSeconds(footpaths, at_stop, board_stop);
+                found.predecessors.set(board_stop, Journey(at_time, start_time, trips, static_cast<int32_t>(at_stop), LegKind::Walk));
+                at_stop = board_stop;
+            }
+            uint32_t leave_at = n + 1 < chain.size() ? ws.segments[chain[n + 1]].parent_alight : alight;
+            at_stop = timetable.stop(seg.pattern, leave_at);
+            at_time = Time(timetable.arrival(seg.pattern, seg.trip, leave_at));
+            found.journey = Journey(at_time, start_time, trips + 1, static_cast<int32_t>(board_stop), LegKind::Trip,
+                                    timetable.patterns[seg.pattern].first_trip + seg.trip);
+            if (n + 1 < chain.size() || at_stop != end_stop_idx) found.predecessors.set(at_stop, found.journey);
+        }
+        finishOnFoot(found, at_stop, at_time, static_cast<int>(chain.size()));
+        return found;
+    };
+
+    // Round n rides the segments reached with n transfers
+    size_t round_begin = 0;
+    for (int n = 0; n < MAX_TRIPS && round_begin < ws.segments.size(); ++n) {
+        const size_t round_end = ws.segments.size();
+
+        // Does any segment of this round reach the destination earlier?
+        uint32_t best_segment = NO_SEGMENT, best_alight = 0;
+        for (size_t s = round_begin; s < round_end; ++s) {
+            const TripSegment& seg = ws.segments[s];
+            for (uint32_t k = seg.first + 1; k <= seg.last; ++k) {
+                const int32_t arrival = timetable.arrival(seg.pattern, seg.trip, k);
+                if (arrival >= best_arrival) break;
+                const uint32_t stop = timetable.stop(seg.pattern, k);
+                if (ws.canWalkToEnd(stop) && arrival + ws.walk_to_end[stop] < best_arrival) {
+                    best_arrival = arrival + ws.walk_to_end[stop];
+                    best_segment = static_cast<uint32_t>(s);
+                    best_alight = k;
+                }
+            }
+        }
+        if (best_segment != NO_SEGMENT) journeys.push_back(buildJourney(best_segment, best_alight));
+
+        if (n + 1 == MAX_TRIPS) break;
+
+        // Transfer onwards from every stop reached before the best arrival so far
+        for (size_t s = round_begin; s < round_end; ++s) {
+            const TripSegment seg = ws.segments[s]; // enqueue may grow the vector
+            for (uint32_t k = seg.first + 1; k <= seg.last; ++k) {
+                const uint32_t event = timetable.event(seg.pattern, seg.trip, k);
+                if (timetable.arrivals[event] >= best_arrival) break;
+                for (const uint32_t* target = transfers.begin(event); target != transfers.end(event); ++target) {
+                    uint32_t p = timetable.patternOfEvent(*target);
+                    const RoutePattern& route = timetable.patterns[p];
+                    uint32_t offset = *target - route.first_event;
+                    enqueue(p, offset / route.num_stops, offset % route.num_stops, static_cast<uint32_t>(s), k);
+                }
+            }
+        }
+        round_begin = round_end;
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef TRIPBASED_H_INCLUDED
+#define TRIPBASED_H_INCLUDED
+
+#include <vector>
+#include <cstdint>
+#include "DataTypes.h"
+#include "Network.h"
+#include "Raptor.h" // ProfileJourney, MAX_TRIPS
+
+// Trip-Based Routing: a breadth-first search over trips along the precomputed transfers of
+// Network::trip_transfers. Round n scans the trip segments reachable with n transfers, so
+// like RAPTOR it returns the journeys to end_stop_idx that are Pareto-optimal in arrival
+// time and number of trips (up to MAX_TRIPS), each with the labels to reconstruct it.
+// Walks are those of the Connection Scan (ConnectionScan.h): one footpath to the first trip
+// and between trips, and up to two from the last trip, or on their own, to the destination.
+void runTripBasedQuery(uint32_t start_stop_idx, uint32_t end_stop_idx, const Time& start_time,
+                       const StopTable& stops,
+                       const FootpathGraph& footpaths,
+                       const Timetable& timetable,
+                       const TripTransferGraph& transfers,
+                       std::vector<ProfileJourney>& journeys);
+
+#endif // TRIPBASED_H_INCLUDED
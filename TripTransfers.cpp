@@ -0,0 +1,98 @@
+#include "TripTransfers.h"
+#include "Parallel.h"
+#include <vector>
+#include <algorithm>
+#include <climits>
+
+TripTransferGraph buildTripTransfers(const Timetable& timetable, const FootpathGraph& footpaths, size_t num_stops) {
+    const uint32_t num_events = static_cast<uint32_t>(timetable.arrivals.size());
+    const uint32_t num_trips = static_cast<uint32_t>(timetable.pattern_trips.size());
+
+    // Trips are independent. Blocks of trip slots run in parallel, each into its own target
+    // list; slots are in event order, so the blocks concatenate into the final layout.
+    const size_t block_size = 64;
+    std::vector<std::vector<uint32_t>> block_targets((num_trips + block_size - 1) / block_size);
+    std::vector<uint32_t> out_degree(num_events, 0);
+
+    parallelFor(num_trips, block_size, [&](size_t begin, size_t end) {
+        // Earliest arrival at each stop known while scanning the current trip backwards. Only
+        // stops are tracked, not the walks from them: a transfer that reaches no stop earlier
+        // cannot reach anything earlier on foot either.
+        std::vector<int32_t> earliest(num_stops, INT32_MAX);
+        std::vector<uint32_t> touched;
+        std::vector<std::vector<uint32_t>> at_position; // kept transfers by alighting position
+        std::vector<uint32_t>& targets = block_targets[begin / block_size];
+        auto improve = [&](uint32_t stop, int32_t arrival) {
+            if (arrival >= earliest[stop]) return false;
+            if (earliest[stop] == INT32_MAX) touched.push_back(stop);
+            earliest[stop] = arrival;
+            return true;
+        };
+
+        uint32_t p = timetable.patternOfTrip(static_cast<uint32_t>(begin));
+        for (uint32_t slot = static_cast<uint32_t>(begin); slot < end; ++slot) {
+            while (slot >= timetable.patterns[p].first_trip + timetable.patterns[p].num_trips) ++p;
+            const RoutePattern& route = timetable.patterns[p];
+            const uint32_t t = slot - route.first_trip;
+            if (at_position.size() < route.num_stops) at_position.resize(route.num_stops);
+
+            // Transfers to the earliest trip of every pattern at board_stop, ready to leave at `ready`
+            auto transfersFrom = [&](uint32_t i, uint32_t board_stop, int32_t ready) {
+                for (const PatternStop* ps = timetable.patternsAtBegin(board_stop); ps != timetable.patternsAtEnd(board_stop); ++ps) {
+                    const RoutePattern& other = timetable.patterns[ps->pattern];
+                    const uint32_t j = ps->position;
+                    if (j + 1 == other.num_stops) continue; // nowhere to ride to
+                    const uint32_t u = timetable.earliestTrip(ps->pattern, j, ready, other.num_trips);
+                    if (u == other.num_trips) continue;
+                    // Staying on the trip is at least as good
+                    if (ps->pattern == p && u >= t && j >= i) continue;
+                    // A U-turn: the other trip could have been caught one stop earlier
+                    if (timetable.stop(p, i - 1) == timetable.stop(ps->pattern, j + 1) &&
+                        timetable.arrival(p, t, i - 1) <= timetable.departure(ps->pattern, u, j + 1)) {
+                        continue;
+                    }
+                    // Keep it only if it reaches some stop earlier than anything so far
+                    bool useful = false;
+                    for (uint32_t k = j + 1; k < other.num_stops; ++k) {
+                        useful |= improve(timetable.stop(ps->pattern, k), timetable.arrival(ps->pattern, u, k));
+                    }
+                    if (useful) at_position[i].push_back(timetable.event(ps->pattern, u, j));
+                }
+            };
+
+            // Latest stop first, so staying seated and the transfers further down the trip
+            // are known when a transfer is judged
+            for (uint32_t i = route.num_stops - 1; i >= 1; --i) {
+                const uint32_t stop = timetable.stop(p, i);
+                const int32_t arrival = timetable.arrival(p, t, i);
+                improve(stop, arrival);
+                transfersFrom(i, stop, arrival);
+                for (const Footpath* walk = footpaths.outBegin(stop); walk != footpaths.outEnd(stop); ++walk) {
+                    transfersFrom(i, walk->stop, arrival + walk->duration_seconds);
+                }
+            }
+
+            for (uint32_t i = 0; i < route.num_stops; ++i) {
+                out_degree[timetable.event(p, t, i)] = static_cast<uint32_t>(at_position[i].size());
+                targets.insert(targets.end(), at_position[i].begin(), at_position[i].end());
+                at_position[i].clear();
+            }
+            for (uint32_t stop : touched) earliest[stop] = INT32_MAX;
+            touched.clear();
+        }
+    });
+
+    std::vector<uint32_t> offsets(num_events + 1, 0);
+    for (uint32_t e = 0; e < num_events; ++e) offsets[e + 1] = offsets[e] + out_degree[e];
+    std::vector<uint32_t> targets;
+    targets.reserve(offsets[num_events]);
+    for (auto& block : block_targets) {
+        targets.insert(targets.end(), block.begin(), block.end());
+        std::vector<uint32_t>().swap(block);
+    }
+
+    TripTransferGraph graph;
+    graph.offsets = std::move(offsets);
+    graph.targets = std::move(targets);
+    return graph;
+}
@@ -0,0 +1,28 @@
+#ifndef TRIPTRANSFERS_H_INCLUDED
+#define TRIPTRANSFERS_H_INCLUDED
+
+#include <cstdint>
+#include "FlatArray.h"
+#include "Timetable.h"
+#include "Footpaths.h"
+
+// Transfers between trips for Trip-Based Routing (TripBased.h), in compressed sparse row form
+// over the timetable's stop events: alighting at event e one can catch the events
+// targets[offsets[e], offsets[e + 1]). Each target is the boarding event itself (an index
+// into Timetable::arrivals / departures), which is all a transfer needs to store.
+struct TripTransferGraph {
+    FlatArray<uint32_t> offsets; // size num_events + 1
+    FlatArray<uint32_t> targets;
+
+    const uint32_t* begin(uint32_t event) const { return targets.data() + offsets[event]; }
+    const uint32_t* end(uint32_t event) const { return targets.data() + offsets[event + 1]; }
+};
+
+// For every stop event, the earliest trip of each pattern that can be caught at the stop or
+// by walking from it. Transfers that are never useful are left out: staying on the same
+// line, U-turns back to the previous stop, and transfers after which no stop is reached
+// earlier than by staying seated or by a transfer further down the trip. Trips are processed
+// in parallel.
+TripTransferGraph buildTripTransfers(const Timetable& timetable, const FootpathGraph& footpaths, size_t num_stops);
+
+#endif // TRIPTRANSFERS_H_INCLUDED
@@ -1,51 +1,110 @@
-#define _WIN32_WINNT 0x0A00 // We are targeting Windows 10 or later
-
 #include <iostream>
 #include <vector>
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <memory>
 //#include <map>
 #include <algorithm>
 
 #include "httplib.h" // The web server library
 #include "DataTypes.h"
 #include "Raptor.h"
-
-#include <windows.h>      // For resource loading functions (FindResource, etc.)
-#include "resources.h"    // For your resource IDs (IDR_INDEX_HTML, etc.)
-
-#include "robin_hood.h"
+#include "ConnectionScan.h"
+#include "TripBased.h"
+#include "Timetable.h"
+#include "StopGrid.h"
+#include "Footpaths.h"
+#include "Network.h"
+#include "Snapshot.h"
+#include "Isochrone.h"
+#include "Parallel.h"
+#include "GtfsCsv.h" // parseNumber
+
+#include "MappedFile.h"
 
 // Helper function implementations that were previously in main.cpp
 std::ostream& operator<<(std::ostream& os, const Time& t) {
-    char buffer[9];
-    sprintf(buffer, "%02d:%02d:%02d", t.h, t.m, t.s);
+    char buffer[16];
+    int32_t total = t.toSeconds();
+    snprintf(buffer, sizeof(buffer), "%02d:%02d:%02d", total / 3600, (total % 3600) / 60, total % 60);
     os << buffer;
     return os;
 }
 
-std::string getStopName(int stop_id, const robin_hood::unordered_map<int, Stop>& stops) {
-    auto it = stops.find(stop_id);
-    return (it != stops.end()) ? it->second.name : "Unknown Stop";
+std::string getStopName(uint32_t stop_idx, const StopTable& stops) {
+    return (stop_idx < stops.size()) ? std::string(stops.names[stop_idx]) : "Unknown Stop";
+}
+
+// Dense index of the stop with the GTFS id in `text`; NOT_FOUND if the id is malformed or unknown
+uint32_t findStop(std::string_view text, const StopTable& stops) {
+    int32_t gtfs_id;
+    return parseNumber(text, gtfs_id) ? stops.find(gtfs_id) : StopTable::NOT_FOUND;
 }
 
+// Parses a comma-separated list of GTFS stop ids into dense indices; false on a malformed or
+// unknown id, an empty entry included
+bool parseStopList(std::string_view list, const StopTable& stops, std::vector<uint32_t>& stop_idxs) {
+    for (;;) {
+        size_t comma = list.find(',');
+        uint32_t stop_idx = findStop(list.substr(0, comma), stops);
+        if (stop_idx == StopTable::NOT_FOUND) return false;
+        stop_idxs.push_back(stop_idx);
+        if (comma == std::string_view::npos) return true;
+        list.remove_prefix(comma + 1);
+    }
+}
 
 // --- NEW: Path Reconstruction Function ---
-std::vector<PathStep> reconstructPath(int start_id, int end_id, const Journey& final_journey,
-                                      const robin_hood::unordered_map<int, robin_hood::unordered_map<int, Journey>>& predecessors,
-                                      const robin_hood::unordered_map<int, Stop>& stops) {
+// Appends the stops of a trip leg from alighting back to (not including) boarding,
+// since the path is assembled backwards.
+void appendTripLeg(int board_idx, int alight_idx, const Journey& leg, const Timetable& timetable,
+                   const StringTable& trip_ids, const StopTable& stops, std::vector<PathStep>& path) {
+    std::string method = "Trip " + std::string(trip_ids[timetable.pattern_trips[leg.trip()]]);
+    uint32_t p = timetable.patternOfTrip(leg.trip());
+    const RoutePattern& route = timetable.patterns[p];
+    uint32_t t = leg.trip() - route.first_trip;
+
+    uint32_t board_pos = route.num_stops, alight_pos = route.num_stops;
+    for (uint32_t i = 0; i < route.num_stops; ++i) {
+        uint32_t s = timetable.stop(p, i);
+        if (board_pos == route.num_stops) { if (s == static_cast<uint32_t>(board_idx)) board_pos = i; }
+        else if (s == static_cast<uint32_t>(alight_idx)) { alight_pos = i; break; }
+    }
+    if (alight_pos == route.num_stops) { // should not happen, fall back to the alighting stop only
+        path.push_back({stops.ids[alight_idx], getStopName(alight_idx, stops), leg.arrival_time, method});
+        return;
+    }
+    for (uint32_t i = alight_pos; i > board_pos; --i) {
+        uint32_t s = timetable.stop(p, i);
+        path.push_back({stops.ids[s], getStopName(s, stops), Time(timetable.arrival(p, t, i)), method});
+    }
+}
+
+std::vector<PathStep> reconstructPath(int start_idx, int end_idx, const Journey& final_journey,
+                                      const JourneyLegs& predecessors,
+                                      const StopTable& stops, const Timetable& timetable,
+                                      const StringTable& trip_ids) {
     std::vector<PathStep> path;
     Journey current_journey = final_journey;
-    int current_stop = end_id;
-
-    while (current_stop != start_id && current_journey.from_stop_id != -1) {
-        path.push_back({current_stop, getStopName(current_stop, stops), current_journey.arrival_time, current_journey.method});
-        int prev_stop = current_journey.from_stop_id;
-        int prev_trips = current_journey.method == "Walk" ? current_journey.trips : current_journey.trips - 1;
+    int current_stop = end_idx;
+
+    // A journey has at most one walk before and after each trip. The leg bound guards against
+    // label chains that loop when a footpath label overwrote the one it was relaxed from.
+    const int max_legs = 2 * final_journey.trips() + 3;
+    for (int legs = 0; legs < max_legs && current_stop != start_idx && current_journey.kind() != LegKind::Start; ++legs) {
+        int prev_stop = current_journey.from_stop_idx;
+        int prev_trips = current_journey.trips();
+        if (current_journey.kind() == LegKind::Trip) {
+            appendTripLeg(prev_stop, current_stop, current_journey, timetable, trip_ids, stops, path);
+            prev_trips -= 1;
+        } else {
+            path.push_back({stops.ids[current_stop], getStopName(current_stop, stops), current_journey.arrival_time, "Walk"});
+        }
 
-        if (predecessors.count(prev_stop) && predecessors.at(prev_stop).count(prev_trips)) {
-            current_journey = predecessors.at(prev_stop).at(prev_trips);
+        const Journey* previous = prev_stop < 0 ? nullptr : predecessors.find(static_cast<uint32_t>(prev_stop), prev_trips);
+        if (previous) {
+            current_journey = *previous;
             current_stop = prev_stop;
         } else {
             break; // Path reconstruction finished or error
@@ -55,100 +114,55 @@ std::vector<PathStep> reconstructPath(int start_id, int end_id, const Journey& f
     return path;
 }
 
-// Helper function to load an embedded resource into a string
-std::string loadResourceAsString(int resourceID) {
-    HRSRC hRes = FindResource(NULL, MAKEINTRESOURCE(resourceID), RT_RCDATA);
-    if (hRes == NULL) {
-        return "";
+// Writes one journey of a result list as JSON
+void writeJourneyJson(std::ostream& json, const Journey& journey, const std::vector<PathStep>& path) {
+    json << "{\"departure_time\":\"" << journey.departure_time << "\",\"arrival_time\":\"" << journey.arrival_time << "\",\"trips\":" << journey.trips() << ",\"path\":[";
+    for (auto p_it = path.begin(); p_it != path.end(); ++p_it) {
+        json << "{\"stop_id\":" << p_it->stop_id << ", \"stop_name\":\"" << p_it->stop_name << "\", \"arrival_time\":\"" << p_it->arrival_time << "\", \"method\":\"" << p_it->method << "\"}";
+        if (std::next(p_it) != path.end()) json << ",";
     }
-
-    HGLOBAL hResLoad = LoadResource(NULL, hRes);
-    if (hResLoad == NULL) {
-        return "";
-    }
-
-    LPVOID pResLock = LockResource(hResLoad);
-    if (pResLock == NULL) {
-        return "";
-    }
-
-    DWORD dwSize = SizeofResource(NULL, hRes);
-
-    return std::string(static_cast<char*>(pResLock), dwSize);
+    json << "]}";
 }
 
+// Usage: TemporalPathfinder [data_dir [web_dir]]
+//        TemporalPathfinder --compile [data_dir]
+// data_dir holds the GTFS .txt files, web_dir index.html, style.css and script.js.
+// --compile preprocesses the GTFS files once and writes data_dir/timetable.bin; while that
+// snapshot matches the GTFS files the server maps it instead of parsing them again.
+int main(int argc, char* argv[]) {
+    const bool compile = (argc > 1 && std::string(argv[1]) == "--compile");
+    const int first_arg = compile ? 2 : 1;
+    const std::string data_dir = (argc > first_arg) ? argv[first_arg] : "data";
+    const std::string web_dir = (argc > first_arg + 1) ? argv[first_arg + 1] : "text";
+    const std::string snapshot_path = joinPath(data_dir, SNAPSHOT_FILE_NAME);
 
-int main() {
     // --- 1. Load and Pre-process GTFS Data (Happens once at startup) ---
-    robin_hood::unordered_map<int, Stop> stops;
-    std::vector<StopTime> stop_times;
-    robin_hood::unordered_map<int, std::vector<Transfer>> transfers_map;
-    robin_hood::unordered_map<std::string, std::vector<StopTime>> trips_map;
-    robin_hood::unordered_map<int, std::vector<std::string>> routes_serving_stop;
-    robin_hood::unordered_map<std::string, robin_hood::unordered_map<int, int>> trip_stop_indices;
-    // [Omitted repetitive file loading code for brevity - keep your existing loaders]
-
-    // --- THIS IS THE NEW, CORRECTED BLOCK FOR YOUR main() ---
-    std::string line;
-
-    // Load stops.txt from resources
-    std::string stops_data = loadResourceAsString(IDR_STOPS_TXT);
-    std::stringstream stops_stream(stops_data);
-    getline(stops_stream, line); // Skip header line
-    while (getline(stops_stream, line)) {
-        // Your existing parsing logic for stops is perfect and needs no changes.
-        std::stringstream ss(line);
-        std::string stop_id_str, stop_code, stop_name, stop_lat_str, stop_lon_str;
-        Stop s;
-        getline(ss, stop_id_str, ',');
-        getline(ss, stop_code, ',');
-        getline(ss, stop_name, ',');
-        getline(ss, stop_lat_str, ',');
-        getline(ss, stop_lon_str, ',');
-        try {
-            s.id = std::stoi(stop_id_str);
-            s.name = stop_name;
-            s.lat = std::stod(stop_lat_str);
-            s.lon = std::stod(stop_lon_str);
-            stops[s.id] = s;
-        } catch (const std::exception& e) {}
-    }
-
-    // Load stop_times.txt from resources
-    std::string st_data = loadResourceAsString(IDR_STOP_TIMES_TXT);
-    std::stringstream st_stream(st_data);
-    getline(st_stream, line); // Skip header line
-    while (getline(st_stream, line)) {
-        // Your existing parsing logic for stop_times is perfect.
-        std::stringstream ss(line); std::string field; StopTime st; getline(ss, field, ','); st.trip_id = field; getline(ss, field, ','); st.arrival_time = Time(field); getline(ss, field, ','); st.departure_time = Time(field); getline(ss, field, ','); st.stop_id = std::stoi(field); getline(ss, field, ','); st.stop_sequence = std::stoi(field); stop_times.push_back(st);
+    Network network;
+    MappedFile snapshot_file; // backs `network` when it comes from a snapshot
+    if (compile) {
+        if (!buildNetwork(data_dir, network)) return 1;
+        if (!writeSnapshot(network, snapshot_path, data_dir)) return 1;
+        std::cout << "Snapshot written to " << snapshot_path << std::endl;
+        return 0;
     }
-
-    // Load transfers.txt from resources
-    std::string tr_data = loadResourceAsString(IDR_TRANSFERS_TXT);
-    std::stringstream tr_stream(tr_data);
-    getline(tr_stream, line); // Skip header line
-    while (getline(tr_stream, line)) {
-        // Your existing parsing logic for transfers is perfect.
-        std::stringstream ss(line); std::string field; Transfer t; getline(ss, field, ','); t.from_stop_id = std::stoi(field); getline(ss, field, ','); t.to_stop_id = std::stoi(field); getline(ss, field, ','); t.duration_seconds = std::stoi(field); transfers_map[t.from_stop_id].push_back(t);
+    if (openSnapshot(snapshot_path, data_dir, snapshot_file, network)) {
+        std::cout << "Using preprocessed snapshot " << snapshot_path << std::endl;
+    } else if (!buildNetwork(data_dir, network)) {
+        return 1;
     }
+    const StopTable& stops = network.stops;
+    const StringTable& trip_ids = network.trip_ids;
+    const Timetable& timetable = network.timetable;
+    const StopGrid& stop_grid = network.stop_grid;
+    const FootpathGraph& footpaths = network.footpaths;
 
-    for (const auto& st : stop_times) {
-        trips_map[st.trip_id].push_back(st);
-        routes_serving_stop[st.stop_id].push_back(st.trip_id);
-    }
-    for (auto& pair : trips_map) { std::sort(pair.second.begin(), pair.second.end(), [](const StopTime& a, const StopTime& b) { return a.stop_sequence < b.stop_sequence; }); }
-    for (auto& pair : routes_serving_stop) { std::sort(pair.second.begin(), pair.second.end()); pair.second.erase(std::unique(pair.second.begin(), pair.second.end()), pair.second.end()); }
-
-    std::cout << "Pre-calculating trip stop indices for fast lookups..." << std::endl;
-    for (const auto& pair : trips_map) {
-        const std::string& trip_id = pair.first;
-        const std::vector<StopTime>& schedule = pair.second;
-        for (size_t i = 0; i < schedule.size(); ++i) {
-            trip_stop_indices[trip_id][schedule[i].stop_id] = i;
-        }
-    }
+    // Matrix and profile queries run on the worker pool; start its threads before the first request
+    workerPool();
 
+    // Bound for the optional distance pruning of route queries (prune=distance)
+    const double max_speed_mps = maxTravelSpeed(stops, footpaths, timetable);
     std::cout << "Data loaded and pre-processed for server." << std::endl;
+    std::cout << "Fastest travel between stops: " << max_speed_mps << " m/s" << std::endl;
 
     // --- 2. Create and Configure the Web Server ---
     httplib::Server svr;
@@ -157,25 +171,27 @@ int main() {
     // REMOVE the svr.set_base_dir("./"); line completely.
     // It is now replaced by these handlers below.
 
+    // The web assets are small; read them once instead of on every request
+    const std::string index_html = readFile(joinPath(web_dir, "index.html"));
+    const std::string style_css = readFile(joinPath(web_dir, "style.css"));
+    const std::string script_js = readFile(joinPath(web_dir, "script.js"));
+
     // Serve index.html for the root URL "/"
-    svr.Get("/", [](const httplib::Request&, httplib::Response& res) {
-        std::string content = loadResourceAsString(IDR_INDEX_HTML);
-        res.set_content(content, "text/html; charset=utf-8");
+    svr.Get("/", [&](const httplib::Request&, httplib::Response& res) {
+        res.set_content(index_html, "text/html; charset=utf-8");
     });
 
     // Serve the CSS file
     // --- NEW, CORRECTED CODE ---
 
     // Serve the CSS file
-    svr.Get("/style.css", [](const httplib::Request&, httplib::Response& res) {
-        std::string content = loadResourceAsString(IDR_STYLE_CSS);
-        res.set_content(content, "text/css"); // Add the correct MIME type
+    svr.Get("/style.css", [&](const httplib::Request&, httplib::Response& res) {
+        res.set_content(style_css, "text/css"); // Add the correct MIME type
     });
 
     // Serve the JavaScript file
-    svr.Get("/script.js", [](const httplib::Request&, httplib::Response& res) {
-        std::string content = loadResourceAsString(IDR_SCRIPT_JS);
-        res.set_content(content, "application/javascript"); // Add the correct MIME type
+    svr.Get("/script.js", [&](const httplib::Request&, httplib::Response& res) {
+        res.set_content(script_js, "application/javascript"); // Add the correct MIME type
     });
 
 
@@ -183,20 +199,49 @@ int main() {
     svr.Get("/api/stops", [&](const httplib::Request& req, httplib::Response& res) {
         std::stringstream json;
         json << "[";
-        for (auto it = stops.begin(); it != stops.end(); ++it) {
+        for (size_t s = 0; s < stops.size(); ++s) {
             // Add lat and lon to the JSON response
-            json << "{\"id\":" << it->first
-                << ",\"name\":\"" << it->second.name
-                << "\",\"lat\":" << it->second.lat
-                << ",\"lon\":" << it->second.lon
+            json << "{\"id\":" << stops.ids[s]
+                << ",\"name\":\"" << stops.names[s]
+                << "\",\"lat\":" << stops.lats[s]
+                << ",\"lon\":" << stops.lons[s]
                 << "}";
-            if (std::next(it) != stops.end()) json << ",";
+            if (s + 1 != stops.size()) json << ",";
 
         }
         json << "]";
         res.set_content(json.str(), "application/json");
     });
 
+    // API Endpoint to find the stops closest to a coordinate
+    svr.Get("/api/stops/nearest", [&](const httplib::Request& req, httplib::Response& res) {
+        if (!req.has_param("lat") || !req.has_param("lon")) {
+            res.status = 400;
+            res.set_content("{\"error\":\"Missing required parameters: lat, lon\"}", "application/json");
+            return;
+        }
+        double lat = std::stod(req.get_param_value("lat"));
+        double lon = std::stod(req.get_param_value("lon"));
+        size_t limit = req.has_param("limit") ? std::stoul(req.get_param_value("limit")) : 10;
+        double radius = req.has_param("radius") ? std::stod(req.get_param_value("radius")) : MAX_WALK_DISTANCE_METERS;
+
+        std::stringstream json;
+        json << "[";
+        auto nearest = stop_grid.nearest(lat, lon, limit, radius);
+        for (auto it = nearest.begin(); it != nearest.end(); ++it) {
+            uint32_t s = it->first;
+            json << "{\"id\":" << stops.ids[s]
+                << ",\"name\":\"" << stops.names[s]
+                << "\",\"lat\":" << stops.lats[s]
+                << ",\"lon\":" << stops.lons[s]
+                << ",\"distance\":" << static_cast<int>(it->second)
+                << "}";
+            if (std::next(it) != nearest.end()) json << ",";
+        }
+        json << "]";
+        res.set_content(json.str(), "application/json");
+    });
+
     // API Endpoint to calculate a route
     svr.Get("/api/route", [&](const httplib::Request& req, httplib::Response& res) {
         // Check for required parameters
@@ -207,52 +252,225 @@ int main() {
         }
 
         // Parse parameters from the URL
-        int start_node = std::stoi(req.get_param_value("from"));
-        int end_node = std::stoi(req.get_param_value("to"));
         std::string time_str = req.get_param_value("time");
-        // --- ADD THESE DEBUGGING LINES ---
-        std::cout << "--------------------------------" << std::endl;
-        std::cout << "New Route Request:" << std::endl;
-        std::cout << "FROM: " << start_node << " (" << getStopName(start_node, stops) << ")" << std::endl;
-        std::cout << "TO:   " << end_node << " (" << getStopName(end_node, stops) << ")" << std::endl;
-        std::cout << "TIME: " << time_str << std::endl;
-        std::cout << "--------------------------------" << std::endl;
-
-        // Execute the RAPTOR algorithm
-        robin_hood::unordered_map<int, std::vector<Journey>> final_profiles;
+        Time departure;
+        if (!Time::parse(time_str, departure)) {
+            res.status = 400;
+            res.set_content("{\"error\":\"Malformed time, expected H:MM:SS\"}", "application/json");
+            return;
+        }
 
-        // *** FIX 1: DECLARE the predecessors map here ***
-        robin_hood::unordered_map<int, robin_hood::unordered_map<int, Journey>> predecessors;
+        // Translate GTFS stop ids to the dense indices used by the router
+        uint32_t start_node = findStop(req.get_param_value("from"), stops);
+        uint32_t end_node = findStop(req.get_param_value("to"), stops);
+        if (start_node == StopTable::NOT_FOUND || end_node == StopTable::NOT_FOUND) {
+            res.status = 400;
+            res.set_content("{\"error\":\"Unknown stop id\"}", "application/json");
+            return;
+        }
 
-        // *** FIX 2: PASS the predecessors map to the function ***
-        // --- THE CORRECTED CODE ---
-        runMultiCriteriaRaptor(start_node, end_node, Time(time_str), stops, transfers_map, trips_map, routes_serving_stop, trip_stop_indices, final_profiles, predecessors);
+        // Execute the RAPTOR algorithm
+        // The result list is kept per server thread, so its capacity is reused across requests
+        thread_local std::vector<ProfileJourney> results;
+        results.clear();
+
+        // engine=csa answers with the single earliest arrival from the Connection Scan Algorithm,
+        // engine=tb with the same journeys as RAPTOR from Trip-Based Routing. prune=distance
+        // adds straight-line lower-bound pruning to RAPTOR, prune=landmarks landmark lower-bound
+        // pruning to RAPTOR and CSA; the journeys are the same.
+        const std::string engine = req.has_param("engine") ? req.get_param_value("engine") : "raptor";
+        const std::string prune = req.has_param("prune") ? req.get_param_value("prune") : "";
+        const bool prune_distance = prune == "distance";
+        const LandmarkTable* landmarks = prune == "landmarks" ? &network.landmarks : nullptr;
+        if (engine == "csa") {
+            results.emplace_back();
+            if (!runConnectionScan(start_node, end_node, departure, stops, footpaths, timetable, network.connections,
+                                   results.back().journey, results.back().predecessors, landmarks)) {
+                results.pop_back();
+            }
+        } else if (engine == "tb") {
+            runTripBasedQuery(start_node, end_node, departure, stops, footpaths, timetable, network.trip_transfers, results);
+        } else if (engine == "raptor") {
+            runMultiCriteriaRaptor(start_node, end_node, departure, stops, footpaths, timetable, results,
+                                   prune_distance ? max_speed_mps : 0, landmarks);
+        } else {
+            res.status = 400;
+            res.set_content("{\"error\":\"Unknown engine, expected raptor, csa or tb\"}", "application/json");
+            return;
+        }
         // Format the result as a JSON string
         std::stringstream json;
         json << "{\"from\":\"" << getStopName(start_node, stops) << "\",\"to\":\"" << getStopName(end_node, stops) << "\",\"results\":[";
+        for (auto it = results.begin(); it != results.end(); ++it) {
+            // For each journey, reconstruct its path
+            std::vector<PathStep> path = reconstructPath(start_node, end_node, it->journey, it->predecessors, stops, timetable, trip_ids);
+            writeJourneyJson(json, it->journey, path);
+            if (std::next(it) != results.end()) json << ",";
+        }
+
+        json << "]}";
 
-        if (final_profiles.count(end_node)) {
-            const auto& results = final_profiles.at(end_node);
-            for (auto it = results.begin(); it != results.end(); ++it) {
-                // For each journey, reconstruct its path
-                std::vector<PathStep> path = reconstructPath(start_node, end_node, *it, predecessors, stops);
+        // Send the JSON back as the response
+        res.set_content(json.str(), "application/json");
+    });
 
-                // *** THIS IS THE LINE TO CHANGE ***
-                json << "{\"departure_time\":\"" << it->departure_time << "\",\"arrival_time\":\"" << it->arrival_time << "\",\"trips\":" << it->trips << ",\"path\":[";
+    // API Endpoint for every useful journey leaving within a time window
+    svr.Get("/api/profile", [&](const httplib::Request& req, httplib::Response& res) {
+        if (!req.has_param("from") || !req.has_param("to") || !req.has_param("start") || !req.has_param("end")) {
+            res.status = 400;
+            res.set_content("{\"error\":\"Missing required parameters: from, to, start, end\"}", "application/json");
+            return;
+        }
+        Time window_start, window_end;
+        if (!Time::parse(req.get_param_value("start"), window_start) || !Time::parse(req.get_param_value("end"), window_end)) {
+            res.status = 400;
+            res.set_content("{\"error\":\"Malformed time, expected H:MM:SS\"}", "application/json");
+            return;
+        }
 
-                // Add path steps to JSON
-                for (auto p_it = path.begin(); p_it != path.end(); ++p_it) {
-                    json << "{\"stop_id\":" << p_it->stop_id << ", \"stop_name\":\"" << p_it->stop_name << "\", \"arrival_time\":\"" << p_it->arrival_time << "\", \"method\":\"" << p_it->method << "\"}";
-                    if (std::next(p_it) != path.end()) json << ",";
+        uint32_t start_node = findStop(req.get_param_value("from"), stops);
+        uint32_t end_node = findStop(req.get_param_value("to"), stops);
+        if (start_node == StopTable::NOT_FOUND || end_node == StopTable::NOT_FOUND) {
+            res.status = 400;
+            res.set_content("{\"error\":\"Unknown stop id\"}", "application/json");
+            return;
+        }
+        if (window_end < window_start) {
+            res.status = 400;
+            res.set_content("{\"error\":\"end is before start\"}", "application/json");
+            return;
+        }
+
+        std::vector<ProfileJourney> profile;
+        runRangeRaptor(start_node, end_node, window_start, window_end, stops, footpaths, timetable, profile);
+
+        std::stringstream json;
+        json << "{\"from\":\"" << getStopName(start_node, stops) << "\",\"to\":\"" << getStopName(end_node, stops)
+             << "\",\"start\":\"" << window_start << "\",\"end\":\"" << window_end << "\",\"results\":[";
+        for (auto it = profile.begin(); it != profile.end(); ++it) {
+            std::vector<PathStep> path = reconstructPath(start_node, end_node, it->journey, it->predecessors, stops, timetable, trip_ids);
+            writeJourneyJson(json, it->journey, path);
+            if (std::next(it) != profile.end()) json << ",";
+        }
+        json << "]}";
+        res.set_content(json.str(), "application/json");
+    });
+
+    // API Endpoint for earliest arrivals from many origins at many targets. Rows are computed a
+    // batch of origins at a time and streamed out as each batch is done.
+    svr.Get("/api/matrix", [&](const httplib::Request& req, httplib::Response& res) {
+        if (!req.has_param("from") || !req.has_param("to") || !req.has_param("time")) {
+            res.status = 400;
+            res.set_content("{\"error\":\"Missing required parameters: from, to, time\"}", "application/json");
+            return;
+        }
+        auto origins = std::make_shared<std::vector<uint32_t>>();
+        auto targets = std::make_shared<std::vector<uint32_t>>();
+        if (!parseStopList(req.get_param_value("from"), stops, *origins) || !parseStopList(req.get_param_value("to"), stops, *targets)) {
+            res.status = 400;
+            res.set_content("{\"error\":\"Unknown stop id\"}", "application/json");
+            return;
+        }
+        Time departure;
+        if (!Time::parse(req.get_param_value("time"), departure)) {
+            res.status = 400;
+            res.set_content("{\"error\":\"Malformed time, expected H:MM:SS\"}", "application/json");
+            return;
+        }
+
+        // A few origins per worker thread keep them all busy between two writes
+        const size_t batch_size = workerCount() * 4;
+        auto next_origin = std::make_shared<size_t>(0);
+        res.set_chunked_content_provider("application/json", [&, origins, targets, departure, batch_size, next_origin](size_t, httplib::DataSink& sink) {
+            std::stringstream json;
+            if (*next_origin == 0) {
+                json << "{\"time\":\"" << departure << "\",\"to\":[";
+                for (size_t t = 0; t < targets->size(); ++t) json << (t ? "," : "") << stops.ids[(*targets)[t]];
+                json << "],\"rows\":[";
+            }
+
+            const size_t first = *next_origin;
+            const size_t count = std::min(batch_size, origins->size() - first);
+            std::vector<int32_t> arrivals;
+            runTravelTimeMatrix(origins->data() + first, count, *targets, departure, stops, footpaths, timetable, arrivals);
+            for (size_t o = 0; o < count; ++o) {
+                json << (first + o ? "," : "") << "{\"from\":" << stops.ids[(*origins)[first + o]] << ",\"arrivals\":[";
+                for (size_t t = 0; t < targets->size(); ++t) {
+                    int32_t arrival = arrivals[o * targets->size() + t];
+                    if (t) json << ",";
+                    if (arrival == UNREACHABLE) json << "null";
+                    else json << "\"" << Time(arrival) << "\"";
                 }
                 json << "]}";
-                if (std::next(it) != results.end()) json << ",";
             }
+            *next_origin = first + count;
+            if (*next_origin == origins->size()) json << "]}";
+
+            const std::string chunk = json.str();
+            if (!sink.write(chunk.data(), chunk.size())) return false;
+            if (*next_origin == origins->size()) sink.done();
+            return true;
+        });
+    });
+
+    // API Endpoint for every stop reachable within a travel-time budget (in minutes). With
+    // cell=<meters> the result is also rasterised onto a lat/lon grid of that cell size.
+    svr.Get("/api/isochrone", [&](const httplib::Request& req, httplib::Response& res) {
+        if (!req.has_param("from") || !req.has_param("time") || !req.has_param("budget")) {
+            res.status = 400;
+            res.set_content("{\"error\":\"Missing required parameters: from, time, budget\"}", "application/json");
+            return;
+        }
+        uint32_t start_node = findStop(req.get_param_value("from"), stops);
+        if (start_node == StopTable::NOT_FOUND) {
+            res.status = 400;
+            res.set_content("{\"error\":\"Unknown stop id\"}", "application/json");
+            return;
+        }
+        Time departure;
+        if (!Time::parse(req.get_param_value("time"), departure)) {
+            res.status = 400;
+            res.set_content("{\"error\":\"Malformed time, expected H:MM:SS\"}", "application/json");
+            return;
+        }
+        int budget_minutes;
+        if (!parseNumber(req.get_param_value("budget"), budget_minutes) || budget_minutes < 0 ||
+            budget_minutes > MAX_ISOCHRONE_BUDGET_MINUTES) {
+            res.status = 400;
+            res.set_content("{\"error\":\"budget must be a whole number of minutes from 0 to " +
+                            std::to_string(MAX_ISOCHRONE_BUDGET_MINUTES) + "\"}", "application/json");
+            return;
         }
+        const int64_t deadline_seconds =
+            static_cast<int64_t>(departure.toSeconds()) + static_cast<int64_t>(budget_minutes) * 60;
+        Time deadline(static_cast<int32_t>(std::min<int64_t>(deadline_seconds, INT32_MAX)));
 
-        json << "]}";
+        std::vector<std::pair<uint32_t, Time>> reached;
+        runIsochrone(start_node, departure, deadline, stops, footpaths, timetable, reached);
 
-        // Send the JSON back as the response
+        // Travel times are reported in whole minutes
+        std::stringstream json;
+        json << "{\"from\":\"" << getStopName(start_node, stops) << "\",\"time\":\"" << departure << "\",\"budget\":" << budget_minutes << ",\"stops\":[";
+        for (auto it = reached.begin(); it != reached.end(); ++it) {
+            json << "{\"id\":" << stops.ids[it->first] << ",\"lat\":" << stops.lats[it->first] << ",\"lon\":" << stops.lons[it->first]
+                 << ",\"arrival_time\":\"" << it->second << "\",\"minutes\":" << (it->second - departure) / 60 << "}";
+            if (std::next(it) != reached.end()) json << ",";
+        }
+        json << "]";
+        if (req.has_param("cell")) {
+            IsochroneRaster raster = rasterizeIsochrone(reached, stops, deadline, std::stod(req.get_param_value("cell")),
+                                                        MAX_WALK_DISTANCE_METERS, WALKING_SPEED_MPS);
+            json << ",\"raster\":{\"min_lat\":" << raster.min_lat << ",\"min_lon\":" << raster.min_lon
+                 << ",\"cell_lat\":" << raster.cell_lat_deg << ",\"cell_lon\":" << raster.cell_lon_deg
+                 << ",\"rows\":" << raster.rows << ",\"cols\":" << raster.cols << ",\"minutes\":[";
+            for (size_t c = 0; c < raster.arrivals.size(); ++c) {
+                if (c) json << ",";
+                if (raster.arrivals[c] == IsochroneRaster::UNREACHED) json << "null";
+                else json << (raster.arrivals[c] - departure.toSeconds()) / 60;
+            }
+            json << "]}";
+        }
+        json << "}";
         res.set_content(json.str(), "application/json");
     });
 
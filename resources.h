@@ -1,15 +0,0 @@
-
-#ifndef RESOURCES_H_INCLUDED
-#define RESOURCES_H_INCLUDED
-
-// --- GTFS Data Files ---
-#define IDR_STOPS_TXT       101
-#define IDR_STOP_TIMES_TXT  102
-#define IDR_TRANSFERS_TXT   103
-
-// --- Web Server Files ---
-#define IDR_INDEX_HTML      201
-#define IDR_STYLE_CSS       202
-#define IDR_SCRIPT_JS       203
-
-#endif // RESOURCES_H_INCLUDED
@@ -0,0 +1,71 @@
+// Checks that route queries allocate nothing once the per-thread workspaces have grown to
+// size. Every heap allocation goes through the counting operator new below; the test runs a
+// fixed set of queries twice and fails if the second pass allocates at all.
+//
+//     g++ -std=c++17 -O2 -I. tests/AllocationTest.cpp $(ls *.cpp | grep -v main.cpp) -o allocation_test -pthread
+//     ./allocation_test [data_dir]
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <vector>
+#include <iostream>
+#include "Network.h"
+#include "Snapshot.h"
+#include "Raptor.h"
+
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+int main(int argc, char* argv[]) {
+    const std::string data_dir = argc > 1 ? argv[1] : "data";
+    Network network;
+    MappedFile snapshot_file;
+    if (!openSnapshot(joinPath(data_dir, SNAPSHOT_FILE_NAME), data_dir, snapshot_file, network) &&
+        !buildNetwork(data_dir, network)) {
+        return 1;
+    }
+    const size_t num_stops = network.stops.size();
+    if (num_stops == 0) {
+        std::cerr << "No stops in " << data_dir << std::endl;
+        return 1;
+    }
+
+    // Stop pairs spread over the network and the day, the same on both passes
+    const int num_queries = 500;
+    auto query = [&](int q, std::vector<ProfileJourney>& journeys, const LandmarkTable* landmarks) {
+        const uint32_t from = static_cast<uint32_t>((q * 7919u) % num_stops);
+        const uint32_t to = static_cast<uint32_t>((q * 104729u + 17) % num_stops);
+        journeys.clear();
+        runMultiCriteriaRaptor(from, to, Time(6 * 3600 + (q * 613) % (16 * 3600)), network.stops, network.footpaths,
+                               network.timetable, journeys, 0, landmarks);
+    };
+
+    std::vector<ProfileJourney> journeys;
+    bool ok = true;
+    const LandmarkTable* pruning[] = {nullptr, &network.landmarks};
+    for (const LandmarkTable* landmarks : pruning) {
+        for (int q = 0; q < num_queries; ++q) query(q, journeys, landmarks); // warm up
+        const size_t before = allocations;
+        size_t found = 0;
+        for (int q = 0; q < num_queries; ++q) {
+            query(q, journeys, landmarks);
+            found += journeys.size();
+        }
+        const size_t allocated = allocations - before;
+        std::cout << (landmarks ? "landmark-pruned" : "plain") << " RAPTOR: " << num_queries << " queries, "
+                  << found << " journeys, " << allocated << " allocations" << std::endl;
+        ok = ok && allocated == 0;
+    }
+    std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+    return ok ? 0 : 1;
+}